@@ -0,0 +1,101 @@
+#include "asynctraceloader.hpp"
+
+#include "trace.hpp"
+
+AsyncTraceLoader::AsyncTraceLoader(const QString& traceFileName) : _cancel(false), _phase((int) Phase::NotStarted), _loadedProcesses(0), _processCount(0) {
+    _rawTrace.setTraceFileName(traceFileName);
+}
+
+AsyncTraceLoader::~AsyncTraceLoader() {
+    cancel();
+    wait();
+}
+
+RawTrace& AsyncTraceLoader::rawTrace() {
+    assert(_thread.joinable() == false);
+    return _rawTrace;
+}
+
+void AsyncTraceLoader::setProgressCallback(const std::function<void(const Progress&)>& f) {
+    assert(_thread.joinable() == false);
+    _progressCallback = f;
+}
+
+void AsyncTraceLoader::setPartialTraceCallback(const std::function<void(std::shared_ptr<const Trace>)>& f, int processesPerBatch) {
+    assert(_thread.joinable() == false);
+    assert(processesPerBatch > 0);
+    _partialTraceCallback = f;
+    _processesPerBatch    = processesPerBatch;
+}
+
+void AsyncTraceLoader::start() {
+    assert(_thread.joinable() == false);
+    assert((Phase) _phase.load() == Phase::NotStarted);
+    _thread = std::thread([this]() { run(); });
+}
+
+void AsyncTraceLoader::cancel() {
+    _cancel = true;
+}
+
+void AsyncTraceLoader::wait() {
+    if (_thread.joinable()) { _thread.join(); }
+}
+
+AsyncTraceLoader::Progress AsyncTraceLoader::progress() const {
+    return Progress{(Phase) _phase.load(), _loadedProcesses.load(), _processCount.load()};
+}
+
+std::shared_ptr<const Trace> AsyncTraceLoader::trace() const {
+    assert(_thread.joinable() == false);
+    return _trace;
+}
+
+void AsyncTraceLoader::run() {
+    _rawTrace.setCancelFlag(&_cancel);
+    _rawTrace.setProgressCallback([this](process_t p) {
+        (void) p;
+        _loadedProcesses += 1;
+        reportProgress();
+    });
+
+    setPhase(Phase::Definitions);
+    _rawTrace.loadDefinitions();
+    if (_cancel) { setPhase(Phase::Cancelled); return; }
+
+    auto processes = _rawTrace.processes().toList();
+    std::sort(processes.begin(), processes.end());
+    _processCount = processes.size();
+
+    setPhase(Phase::Events);
+    if (_partialTraceCallback) {
+        for (int i = 0; i < processes.size(); i += _processesPerBatch) {
+            _rawTrace.loadEvents(processes.mid(i, _processesPerBatch).toSet());
+            if (_cancel) { setPhase(Phase::Cancelled); return; }
+
+            std::shared_ptr<Trace> partial(new Trace);
+            _rawTrace.toPartialTrace(partial.get());
+            _partialTraceCallback(partial);
+        }
+    } else {
+        _rawTrace.loadEvents();
+        if (_cancel) { setPhase(Phase::Cancelled); return; }
+    }
+
+    setPhase(Phase::Matching);
+    std::shared_ptr<Trace> t(new Trace);
+    _rawTrace.toTrace(t.get());
+    if (_cancel) { setPhase(Phase::Cancelled); return; }
+
+    _trace = t;
+    setPhase(Phase::Finished);
+}
+
+void AsyncTraceLoader::setPhase(Phase p) {
+    _phase = (int) p;
+    reportProgress();
+}
+
+void AsyncTraceLoader::reportProgress() {
+    if (_progressCallback) { _progressCallback(progress()); }
+}
@@ -0,0 +1,80 @@
+#ifndef EDGE_BUNDLING_PROTOTYPE_ASYNCTRACELOADER_HPP
+#define EDGE_BUNDLING_PROTOTYPE_ASYNCTRACELOADER_HPP
+
+#include "prereqs.hpp"
+
+#include "rawtrace.hpp"
+
+class Trace;
+
+// Runs definitions -> events -> matching on its own thread, so that e.g. a UI stays responsive.
+//
+// Progress can be polled via progress() or pushed via a callback. cancel() stops loading cooperatively: the readers stop
+// at the next record, and trace() stays empty.
+// Optionally the events are read in batches of processes, and after each batch a partial Trace with the messages
+// between the processes read so far is published. Every partial trace is built from scratch, so batches should not be
+// too small.
+class AsyncTraceLoader {
+public:
+    enum class Phase {
+        NotStarted,
+        Definitions,
+        Events,
+        Matching,
+        Finished,
+        Cancelled,
+    };
+
+    struct Progress {
+        Phase phase;
+        s64   loadedProcesses; // the events of these processes have been read
+        s64   processCount;    // known after Phase::Definitions
+    };
+
+public:
+    AsyncTraceLoader(const QString& traceFileName);
+    ~AsyncTraceLoader(); // cancels and waits
+    AsyncTraceLoader(const AsyncTraceLoader&) = delete;
+    AsyncTraceLoader(AsyncTraceLoader&&)      = delete;
+
+    AsyncTraceLoader& operator=(const AsyncTraceLoader&) = delete;
+    AsyncTraceLoader& operator=(AsyncTraceLoader&&)      = delete;
+
+    // all setters: call before start()
+    RawTrace& rawTrace(); // e.g. to set threads, load strategy or filter. its progress callback and cancel flag are set by the loader
+
+    // called from the loader threads whenever the phase changes or a process has been read. keep it short
+    void setProgressCallback(const std::function<void(const Progress&)>& f);
+    // called from the loading thread after every batch of processesPerBatch processes
+    void setPartialTraceCallback(const std::function<void(std::shared_ptr<const Trace>)>& f, int processesPerBatch);
+
+    void start();
+    void cancel(); // returns immediately. wait() to make sure loading has stopped
+    void wait();
+
+    Progress                     progress() const; // thread safe
+    std::shared_ptr<const Trace> trace()    const; // after wait(). nullptr if cancelled
+
+private:
+    RawTrace _rawTrace;
+
+    std::function<void(const Progress&)>              _progressCallback;
+    std::function<void(std::shared_ptr<const Trace>)> _partialTraceCallback;
+    int                                               _processesPerBatch = 0;
+
+    std::thread       _thread;
+    std::atomic<bool> _cancel;
+
+    std::atomic<int> _phase;
+    std::atomic<s64> _loadedProcesses;
+    std::atomic<s64> _processCount;
+
+    std::shared_ptr<const Trace> _trace;
+
+private:
+    void run();
+    void setPhase(Phase p);
+    void reportProgress();
+};
+
+#endif // EDGE_BUNDLING_PROTOTYPE_ASYNCTRACELOADER_HPP
@@ -0,0 +1,386 @@
+#include "prereqs.hpp"
+
+#include "communicationmatrix.hpp"
+#include "rawtrace.hpp"
+#include "trace.hpp"
+
+// Times the reader on the bundled traces (or the given ones).
+//
+// Every trace is loaded in every configuration below. A configuration runs warm-up times untimed, then repetitions
+// times timed, each time from scratch. Median and minimum over the repetitions are written as json. Given a baseline,
+// i.e. the json of an earlier run, every metric whose median got worse by more than the tolerance is reported and the
+// exit code is 1. With --verify, every configuration of a trace has to produce the same messages, and the same time
+// range as the configurations that also read enter/leave records, or the exit code is 1 as well.
+
+AutoFlushingQTextStream qerr(stderr, QIODevice::WriteOnly);
+AutoFlushingQTextStream qout(stdout, QIODevice::WriteOnly);
+
+struct Config {
+    QString                name;
+    RawTrace::LoadStrategy loadStrategy;
+    bool                   skipEnterLeave;
+    bool                   nativeOtfParsing; // otf traces only
+};
+
+static const QList<Config> configs = {
+    {"per-process",                  RawTrace::LoadStrategy::PerProcess, false, false},
+    {"bulk",                         RawTrace::LoadStrategy::Bulk,       false, false},
+    {"bulk-skip-enter-leave",        RawTrace::LoadStrategy::Bulk,       true,  false},
+    {"per-process-native",           RawTrace::LoadStrategy::PerProcess, false, true },
+    {"bulk-native",                  RawTrace::LoadStrategy::Bulk,       false, true },
+    {"bulk-native-skip-enter-leave", RawTrace::LoadStrategy::Bulk,       true,  true },
+};
+
+static QStringList bundledTraces() {
+    QDir d(BENCHMARK_TRACE_DIR);
+    return QStringList{
+        d.filePath("lulesh-016p-2-iterations/lulesh-trace.otf"),
+        d.filePath("tachyon-253p/tachyon_base.none_copy.otf"),
+        d.filePath("fd4-01024p/a.otf"),
+        d.filePath("vampir.eu-example-large/wrf.otf"),
+    };
+}
+
+// metrics that are shorter are too noisy to compare against the baseline
+static const f64 noiseFloorSeconds = 0.001;
+
+static const int windowCount       = 100; // query windows across the trace
+static const int pyramidLevelCount = 10;
+
+// linux only. resets the peak resident set size of this process, so that every configuration is measured on its own
+static void resetPeakRss() {
+    QFile f("/proc/self/clear_refs");
+    if (f.open(QIODevice::WriteOnly)) { f.write("5"); }
+}
+
+// linux only, 0 elsewhere
+static s64 peakRss() {
+    QFile f("/proc/self/status");
+    if (f.open(QIODevice::ReadOnly | QIODevice::Text) == false) { return 0; }
+    foreach (const auto& line, QString(f.readAll()).split('\n')) {
+        if (line.startsWith("VmHWM:")) { return line.mid(6).trimmed().split(' ').first().toLongLong() * 1024; } // kB
+    }
+    return 0;
+}
+
+static f64 seconds(const QElapsedTimer& t) {
+    return t.nsecsElapsed() * 1e-9;
+}
+
+template<typename T>
+static void addData(QCryptographicHash* h, Trace::Span<T> s) {
+    const s64 maxBytes = std::numeric_limits<int>::max() / sizeof(T) * sizeof(T);
+    const char* data = (const char*) s.begin();
+    for (s64 left = s.size() * (s64) sizeof(T); left > 0; left -= maxBytes, data += maxBytes) {
+        h->addData(data, (int) std::min(left, maxBytes));
+    }
+}
+
+// of the matched messages in order, to compare configurations
+static QString digest(const Trace& t) {
+    QCryptographicHash h(QCryptographicHash::Sha1);
+    auto m = t.allMessages();
+    addData(&h, t.messageOffsets());
+    addData(&h, m.times());
+    addData(&h, m.durations());
+    addData(&h, m.receivers());
+    addData(&h, m.lengths());
+    return h.result().toHex();
+}
+
+using Sample = QMap<QString /*metric*/, f64 /*seconds*/>;
+
+// of the last run
+struct Output {
+    s64         events    = 0;
+    s64         messages  = 0;
+    QString     digest;
+    timestamp_t beginTime = 0;
+    timestamp_t endTime   = 0;
+};
+
+static Sample runOnce(const QString& traceFileName, const Config& c, int threadCount, Output* output) {
+    Sample ret;
+    QElapsedTimer timer;
+    s64 sum = 0; // keeps the queries from being optimized away
+
+    RawTrace r;
+    r.setTraceFileName(traceFileName);
+    r.setLoadThreadCount(threadCount);
+    r.setMatchThreadCount(threadCount);
+    r.setLoadStrategy(c.loadStrategy);
+    r.setSkipEnterLeave(c.skipEnterLeave);
+    r.setNativeOtfParsing(c.nativeOtfParsing);
+    r.setPrintDiagnostics(false);
+
+    timer.start();
+    r.loadDefinitions();
+    ret["loadDefinitions"] = seconds(timer);
+
+    timer.start();
+    r.loadEvents();
+    ret["loadEvents"] = seconds(timer);
+
+    Trace t;
+    timer.start();
+    r.toTrace(&t);
+    ret["toTrace"] = seconds(timer);
+
+    const auto& s = r.statistics();
+    output->events    = s.sends + s.receives + s.isends + s.irecvs + s.enters + s.leaves;
+    output->messages  = t.allMessages().size();
+    output->digest    = digest(t);
+    output->beginTime = t.beginTime();
+    output->endTime   = t.endTime();
+
+    timer.start();
+    foreach (auto p, t.orderedProcesses()) {
+        for (const auto& m : t.messages(p)) { sum += m.length; }
+    }
+    ret["messages"] = seconds(timer);
+
+    const timestamp_t step = std::max((timestamp_t) 1, (t.endTime() - t.beginTime()) / windowCount);
+
+    timer.start();
+    for (int i = 0; i < windowCount; i += 1) {
+        sum += t.messagesInWindow(t.beginTime() + i * step, t.beginTime() + (i+1) * step).size();
+    }
+    ret["messagesInWindow"] = seconds(timer);
+
+    timer.start();
+    sum += t.communication(t.hierarchyLevelCount() - 1).size(); // builds all levels
+    ret["communication"] = seconds(timer);
+
+    timer.start();
+    CommunicationPyramid pyramid(t, pyramidLevelCount, threadCount);
+    for (int i = 0; i < windowCount; i += 1) {
+        sum += pyramid.matrix(t.beginTime() + i * step, t.beginTime() + (i+1) * step).size();
+    }
+    ret["communicationPyramid"] = seconds(timer);
+
+    volatile s64 sink = sum;
+    (void) sink;
+
+    return ret;
+}
+
+static f64 median(QVector<f64> v) {
+    std::sort(v.begin(), v.end());
+    return v.size() % 2 == 1 ? v[v.size() / 2] : (v[v.size() / 2 - 1] + v[v.size() / 2]) / 2;
+}
+
+static QJsonObject run(const QString& traceFileName, const Config& c, int warmup, int repetitions, int threadCount) {
+    Output output;
+
+    for (int i = 0; i < warmup; i += 1) {
+        runOnce(traceFileName, c, threadCount, &output);
+    }
+
+    resetPeakRss();
+
+    QMap<QString, QVector<f64>> samples;
+    for (int i = 0; i < repetitions; i += 1) {
+        auto s = runOnce(traceFileName, c, threadCount, &output);
+        QMapIterator<QString, f64> j(s);
+        while (j.hasNext()) {
+            j.next();
+            samples[j.key()].append(j.value());
+        }
+    }
+
+    QJsonObject metrics;
+    QMapIterator<QString, QVector<f64>> i(samples);
+    while (i.hasNext()) {
+        i.next();
+        metrics[i.key()] = QJsonObject{
+            {"median", median(i.value())},
+            {"min",    *std::min_element(i.value().begin(), i.value().end())},
+        };
+    }
+
+    f64 loadEvents = median(samples["loadEvents"]);
+
+    return QJsonObject{
+        {"trace",           QFileInfo(traceFileName).fileName()},
+        {"config",          c.name},
+        {"skipEnterLeave",  c.skipEnterLeave},
+        {"events",          (qint64) output.events},
+        {"messages",        (qint64) output.messages},
+        {"messageDigest",   output.digest},
+        {"beginTime",       QString::number(output.beginTime)}, // json numbers are doubles
+        {"endTime",         QString::number(output.endTime)},
+        {"eventsPerSecond", loadEvents > 0 ? output.events / loadEvents : 0.0},
+        {"peakRssBytes",    (qint64) peakRss()},
+        {"metrics",         metrics},
+    };
+}
+
+static QString key(const QJsonObject& result) {
+    return result["trace"].toString() + " " + result["config"].toString();
+}
+
+static void print(const QJsonObject& result) {
+    qout << key(result) << ":";
+    auto metrics = result["metrics"].toObject();
+    foreach (const auto& m, metrics.keys()) {
+        qout << " " << m << " " << QString::number(metrics[m].toObject()["median"].toDouble(), 'f', 4) << " s,";
+    }
+    qout << " " << QString::number(result["eventsPerSecond"].toDouble(), 'g', 4) << " events/s, peak rss "
+         << result["peakRssBytes"].toDouble() / (1024 * 1024) << " MiB\n";
+}
+
+// returns the number of regressions
+static int compare(const QJsonArray& results, const QJsonArray& baseline, f64 tolerance) {
+    QHash<QString, QJsonObject> before;
+    foreach (const auto& b, baseline) {
+        before[key(b.toObject())] = b.toObject();
+    }
+
+    int regressions = 0;
+
+    auto check = [&regressions, tolerance](const QString& what, f64 now, f64 then, const QString& unit) {
+        if (now > then * (1 + tolerance)) {
+            qout << "regression: " << what << " " << then << " -> " << now << " " << unit << " (+" << QString::number((now / then - 1) * 100, 'f', 1) << " %)\n";
+            regressions += 1;
+        }
+    };
+
+    foreach (const auto& r, results) {
+        auto now = r.toObject();
+        auto it = before.constFind(key(now));
+        if (it == before.constEnd()) {
+            qout << "note: " << key(now) << " is not in the baseline\n";
+            continue;
+        }
+        const auto& then = it.value();
+
+        auto nowMetrics  = now ["metrics"].toObject();
+        auto thenMetrics = then["metrics"].toObject();
+        foreach (const auto& m, nowMetrics.keys()) {
+            if (thenMetrics.contains(m) == false) { continue; }
+            f64 n = nowMetrics [m].toObject()["median"].toDouble();
+            f64 t = thenMetrics[m].toObject()["median"].toDouble();
+            if (std::max(n, t) < noiseFloorSeconds) { continue; }
+            check(key(now) + " " + m, n, t, "s");
+        }
+
+        if (now["peakRssBytes"].toDouble() > 0 && then["peakRssBytes"].toDouble() > 0) {
+            check(key(now) + " peak rss", now["peakRssBytes"].toDouble() / (1024 * 1024), then["peakRssBytes"].toDouble() / (1024 * 1024), "MiB");
+        }
+    }
+
+    return regressions;
+}
+
+// compares every result with the first one of the same trace. the time range only with the first one that also
+// skipped (or read) enter/leave records. returns the number of differences
+static int verify(const QJsonArray& results) {
+    QHash<QString, QJsonObject> firstOfTrace; // by trace
+    QHash<QString, QJsonObject> firstOfRange; // by trace and skipEnterLeave
+
+    int differences = 0;
+
+    foreach (const auto& r, results) {
+        const auto now   = r.toObject();
+        const auto trace = now["trace"].toString();
+        const auto range = trace + (now["skipEnterLeave"].toBool() ? " skip-enter-leave" : "");
+
+        if (firstOfTrace.contains(trace) == false) { firstOfTrace[trace] = now; }
+        if (firstOfRange.contains(range) == false) { firstOfRange[range] = now; }
+        const auto reference      = firstOfTrace[trace];
+        const auto rangeReference = firstOfRange[range];
+
+        if (now["messageDigest"].toString() != reference["messageDigest"].toString()) {
+            qout << "difference: " << key(now) << " has other messages than " << key(reference) << "\n";
+            differences += 1;
+        }
+        if (now["beginTime"].toString() != rangeReference["beginTime"].toString() || now["endTime"].toString() != rangeReference["endTime"].toString()) {
+            qout << "difference: " << key(now) << " has another time range than " << key(rangeReference) << "\n";
+            differences += 1;
+        }
+    }
+
+    return differences;
+}
+
+int main(int argc, char** argv) {
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Times loading and querying traces. Without arguments the bundled traces are used.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("traces", "otf or otf2 anchor files", "[trace...]");
+
+    QCommandLineOption repetitionsOption("repetitions", "Timed runs per trace and configuration. Default 5.",                          "n", "5"   );
+    QCommandLineOption warmupOption     ("warmup",      "Untimed runs before. Default 1.",                                             "n", "1"   );
+    QCommandLineOption threadsOption    ("threads",     "Load and match threads. 0 (default) uses one per core.",                     "n", "0"   );
+    QCommandLineOption outputOption     ("output",      "Write the results as json to this file.",                                    "file"     );
+    QCommandLineOption baselineOption   ("baseline",    "Compare against the results of an earlier run. Exit code 1 on regressions.", "file"     );
+    QCommandLineOption toleranceOption  ("tolerance",   "Allowed slowdown against the baseline. Default 0.1, i.e. 10 %.",             "f", "0.1" );
+    QCommandLineOption verifyOption     ("verify",      "Check that all configurations read the same. Exit code 1 otherwise."                   );
+    parser.addOptions({repetitionsOption, warmupOption, threadsOption, outputOption, baselineOption, toleranceOption, verifyOption});
+
+    parser.process(app);
+
+    int  repetitions = parser.value(repetitionsOption).toInt();
+    int  warmup      = parser.value(warmupOption)     .toInt();
+    int  threadCount = parser.value(threadsOption)    .toInt();
+    f64  tolerance   = parser.value(toleranceOption)  .toDouble();
+    auto traces      = parser.positionalArguments().isEmpty() ? bundledTraces() : parser.positionalArguments();
+
+    if (repetitions < 1 || warmup < 0 || threadCount < 0 || tolerance < 0) {
+        qerr << "invalid arguments\n";
+        return 2;
+    }
+
+    QJsonArray results;
+    foreach (const auto& trace, traces) {
+        if (QFileInfo(trace).exists() == false) {
+            qerr << "trace \"" << trace << "\" does not exist\n";
+            return 2;
+        }
+        foreach (const auto& c, configs) {
+            if (c.nativeOtfParsing && trace.endsWith(".otf") == false) { continue; } // no effect on otf2
+            auto r = run(trace, c, warmup, repetitions, threadCount);
+            print(r);
+            results.append(r);
+        }
+    }
+
+    QJsonObject document{
+        {"repetitions", repetitions},
+        {"warmup",      warmup},
+        {"threads",     threadCount > 0 ? threadCount : resolveThreadCount(threadCount)},
+        {"results",     results},
+    };
+
+    if (parser.isSet(outputOption)) {
+        QSaveFile f(parser.value(outputOption));
+        if (f.open(QIODevice::WriteOnly) == false || f.write(QJsonDocument(document).toJson()) < 0 || f.commit() == false) {
+            qerr << "could not write \"" << f.fileName() << "\"\n";
+            return 2;
+        }
+    }
+
+    int exitCode = 0;
+
+    if (parser.isSet(verifyOption)) {
+        int differences = verify(results);
+        qout << differences << " differences\n";
+        if (differences > 0) { exitCode = 1; }
+    }
+
+    if (parser.isSet(baselineOption)) {
+        QFile f(parser.value(baselineOption));
+        if (f.open(QIODevice::ReadOnly) == false) {
+            qerr << "could not read \"" << f.fileName() << "\"\n";
+            return 2;
+        }
+        auto baseline = QJsonDocument::fromJson(f.readAll()).object()["results"].toArray();
+        int regressions = compare(results, baseline, tolerance);
+        qout << regressions << " regressions\n";
+        if (regressions > 0) { exitCode = 1; }
+    }
+
+    return exitCode;
+}
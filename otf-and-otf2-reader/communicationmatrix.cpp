@@ -0,0 +1,117 @@
+#include "communicationmatrix.hpp"
+
+#include "trace.hpp"
+
+void addCommunication(CommunicationMatrix* to, const CommunicationMatrix& from) {
+    if (to->isEmpty()) { *to = from; return; }
+
+    for (auto it = from.constBegin(); it != from.constEnd(); ++it) {
+        auto& c = (*to)[it.key()];
+        c.bytes += it.value().bytes;
+        c.count += it.value().count;
+    }
+}
+
+CommunicationPyramid::CommunicationPyramid(const Trace& t, int levelCount, int threadCount) {
+    assert(levelCount >= 1 && levelCount <= 24);
+
+    _beginTime = t.beginTime();
+    _endTime   = std::max(t.beginTime(), t.endTime()) + 1;
+
+    _levels.resize(levelCount);
+    for (int l = 0; l < levelCount; l += 1) {
+        _levels[l].resize(1 << l);
+    }
+
+    const int finest      = levelCount - 1;
+    const int finestCount = binCount(finest);
+
+    auto messages = t.allMessages();
+    auto offsets  = t.messageOffsets();
+    auto time     = messages.times();
+    auto receiver = messages.receivers();
+    auto length   = messages.lengths();
+
+    // finest level: every thread accumulates its senders into its own bins, then the bins are merged
+    threadCount = std::max(1, std::min(resolveThreadCount(threadCount), t.orderedProcesses().size()));
+    std::vector<QVector<CommunicationMatrix>> perThread(threadCount, QVector<CommunicationMatrix>(finestCount));
+
+    parallelFor(t.orderedProcesses().size(), threadCount, [this, &t, &perThread, offsets, time, receiver, length](int p, int thread) {
+        process_t sender = t.orderedProcesses()[p];
+        auto& bins = perThread[thread];
+        for (s64 i = offsets[p]; i < offsets[p+1]; i += 1) {
+            if (receiver[i] < 0 || receiver[i] >= t.orderedProcesses().size()) { continue; } // only in a corrupt cache, see tracecache.hpp
+            auto& c = bins[finestBin(time[i])][qMakePair(sender, t.orderedProcesses()[receiver[i]])];
+            c.bytes += length[i];
+            c.count += 1;
+        }
+    });
+
+    parallelFor(finestCount, threadCount, [this, finest, &perThread](int b, int thread) {
+        (void) thread;
+        for (const auto& bins : perThread) {
+            addCommunication(&_levels[finest][b], bins[b]);
+        }
+    });
+
+    perThread.clear();
+
+    // coarser levels, bottom up
+    for (int l = finest - 1; l >= 0; l -= 1) {
+        parallelFor(binCount(l), threadCount, [this, l](int b, int thread) {
+            (void) thread;
+            _levels[l][b] = _levels[l+1][2*b];
+            addCommunication(&_levels[l][b], _levels[l+1][2*b+1]);
+        });
+    }
+}
+
+int CommunicationPyramid::levelCount() const {
+    return _levels.size();
+}
+
+int CommunicationPyramid::binCount(int level) const {
+    assert(level >= 0 && level < levelCount());
+    return 1 << level;
+}
+
+timestamp_t CommunicationPyramid::binBegin(int level, int bin) const {
+    assert(bin >= 0 && bin <= binCount(level));
+    return _beginTime + (timestamp_t) ((f80) (_endTime - _beginTime) * bin / binCount(level));
+}
+
+timestamp_t CommunicationPyramid::binEnd(int level, int bin) const {
+    return binBegin(level, bin + 1);
+}
+
+const CommunicationMatrix& CommunicationPyramid::matrix(int level, int bin) const {
+    assert(bin >= 0 && bin < binCount(level));
+    return _levels[level][bin];
+}
+
+CommunicationMatrix CommunicationPyramid::matrix(timestamp_t t0, timestamp_t t1) const {
+    CommunicationMatrix ret;
+    if (t1 < t0 || t1 < _beginTime || t0 >= _endTime) { return ret; }
+
+    const int finest = levelCount() - 1;
+
+    // segment tree style: cover [b0, b1) with maximal aligned blocks, walking up the levels
+    int b0 = finestBin(t0);
+    int b1 = finestBin(t1) + 1;
+
+    for (int l = finest; l >= 0 && b0 < b1; l -= 1) {
+        if (b0 & 1) { addCommunication(&ret, _levels[l][b0]); b0 += 1; }
+        if (b1 & 1) { b1 -= 1; addCommunication(&ret, _levels[l][b1]); }
+        b0 /= 2;
+        b1 /= 2;
+    }
+
+    return ret;
+}
+
+int CommunicationPyramid::finestBin(timestamp_t t) const {
+    const int count = binCount(levelCount() - 1);
+    t = std::max(_beginTime, std::min(_endTime - 1, t));
+    int b = (int) ((f80) (t - _beginTime) * count / (_endTime - _beginTime));
+    return std::max(0, std::min(count - 1, b));
+}
@@ -0,0 +1,51 @@
+#ifndef EDGE_BUNDLING_PROTOTYPE_COMMUNICATIONMATRIX_HPP
+#define EDGE_BUNDLING_PROTOTYPE_COMMUNICATIONMATRIX_HPP
+
+#include "prereqs.hpp"
+
+#include "rawtrace.hpp"
+
+class Trace;
+
+struct Communication {
+    messagelength_t bytes = 0;
+    s64             count = 0;
+};
+
+// sparse sender x receiver matrix
+using CommunicationMatrix = QHash<QPair<process_t /*sender*/, process_t /*receiver*/>, Communication>;
+
+void addCommunication(CommunicationMatrix* to, const CommunicationMatrix& from);
+
+// Time-binned communication matrices at power-of-two resolutions between Trace::beginTime() and Trace::endTime().
+// Level l consists of 2^l bins, and every message is counted in the bin of its send time.
+// Building it costs one pass over all messages, in parallel. Queries don't touch messages at all.
+// It is not part of Trace, so only who needs it pays for the memory.
+class CommunicationPyramid {
+public:
+    CommunicationPyramid(const Trace& t, int levelCount, int threadCount = 0); // threadCount 0 uses one thread per core
+    CommunicationPyramid(const CommunicationPyramid&) = delete;
+    CommunicationPyramid& operator=(const CommunicationPyramid&) = delete;
+
+    int levelCount() const;
+    int binCount(int level) const;
+
+    timestamp_t binBegin(int level, int bin) const;
+    timestamp_t binEnd  (int level, int bin) const; // exclusive
+
+    const CommunicationMatrix& matrix(int level, int bin) const;
+
+    // sum over all finest bins that overlap [t0, t1]. i.e. the window is widened to the finest bin borders.
+    // merges O(log(finest bin count)) precomputed matrices.
+    CommunicationMatrix matrix(timestamp_t t0, timestamp_t t1) const;
+
+private:
+    timestamp_t _beginTime;
+    timestamp_t _endTime; // exclusive
+
+    QVector<QVector<CommunicationMatrix>> _levels; // _levels[l].size() == 2^l
+
+    int finestBin(timestamp_t t) const;
+};
+
+#endif // EDGE_BUNDLING_PROTOTYPE_COMMUNICATIONMATRIX_HPP
@@ -0,0 +1,138 @@
+#include "diagnostics.hpp"
+
+Diagnostics::Diagnostics(int maxSamples) : _maxSamples(maxSamples) {
+    assert(maxSamples >= 0);
+}
+
+Diagnostics::Diagnostics(const Diagnostics& o) {
+    *this = o;
+}
+
+Diagnostics& Diagnostics::operator=(const Diagnostics& o) {
+    if (this == &o) { return *this; }
+
+    auto entries = o.entries(); // never hold both locks
+
+    QMutexLocker lock(&_mutex);
+    _maxSamples = o._maxSamples;
+    _entries    = entries;
+    return *this;
+}
+
+void Diagnostics::add(Category c, process_t sender, process_t receiver, timestamp_t time, s64 delta) {
+    QMutexLocker lock(&_mutex);
+
+    auto& e = _entries[Key((int) c, qMakePair(sender, receiver))];
+    e.count   += 1;
+    e.minDelta = std::min(e.minDelta, delta);
+    e.maxDelta = std::max(e.maxDelta, delta);
+    if (e.samples.size() < _maxSamples) { e.samples.append(Sample{time, delta}); }
+}
+
+void Diagnostics::merge(const Diagnostics& o) {
+    if (this == &o) { return; }
+
+    auto entries = o.entries(); // never hold both locks
+
+    QMutexLocker lock(&_mutex);
+
+    QMapIterator<Key, Entry> i(entries);
+    while (i.hasNext()) {
+        i.next();
+        auto& e = _entries[i.key()];
+        e.count   += i.value().count;
+        e.minDelta = std::min(e.minDelta, i.value().minDelta);
+        e.maxDelta = std::max(e.maxDelta, i.value().maxDelta);
+        foreach (const auto& s, i.value().samples) {
+            if (e.samples.size() < _maxSamples) { e.samples.append(s); }
+        }
+    }
+}
+
+void Diagnostics::clear() {
+    QMutexLocker lock(&_mutex);
+    _entries.clear();
+}
+
+bool Diagnostics::isEmpty() const {
+    QMutexLocker lock(&_mutex);
+    return _entries.isEmpty();
+}
+
+s64 Diagnostics::count(Category c) const {
+    QMutexLocker lock(&_mutex);
+
+    s64 ret = 0;
+    QMapIterator<Key, Entry> i(_entries);
+    while (i.hasNext()) {
+        i.next();
+        if (i.key().first == (int) c) { ret += i.value().count; }
+    }
+    return ret;
+}
+
+QMap<Diagnostics::Key, Diagnostics::Entry> Diagnostics::entries() const {
+    QMutexLocker lock(&_mutex);
+    return _entries;
+}
+
+static const char* categoryDescription(Diagnostics::Category c) {
+    switch (c) {
+    case Diagnostics::Category::SendAfterReceive: return "send did not start before receive";
+    case Diagnostics::Category::ReceiveTooShort:  return "receiver receives fewer bytes than sent";
+    }
+    return "";
+}
+
+static const char* deltaUnit(Diagnostics::Category c) {
+    switch (c) {
+    case Diagnostics::Category::SendAfterReceive: return "ticks";
+    case Diagnostics::Category::ReceiveTooShort:  return "bytes";
+    }
+    return "";
+}
+
+QString Diagnostics::toString(int maxPairs) const {
+    auto entries = this->entries();
+
+    QString ret;
+    QTextStream s(&ret);
+
+    for (auto c : {Category::SendAfterReceive, Category::ReceiveTooShort}) {
+        QVector<QPair<QPair<process_t, process_t>, Entry>> pairs;
+        s64 total = 0;
+
+        QMapIterator<Key, Entry> i(entries);
+        while (i.hasNext()) {
+            i.next();
+            if (i.key().first != (int) c) { continue; }
+            pairs.append(qMakePair(i.key().second, i.value()));
+            total += i.value().count;
+        }
+
+        if (pairs.isEmpty()) { continue; }
+
+        s << "warning: " << categoryDescription(c) << ": " << total << " messages between " << pairs.size() << " sender/receiver pairs.\n";
+
+        // most frequent first. stable, so equally frequent pairs stay ordered by sender and receiver
+        std::stable_sort(pairs.begin(), pairs.end(), [](const QPair<QPair<process_t, process_t>, Entry>& a, const QPair<QPair<process_t, process_t>, Entry>& b) {
+            return a.second.count > b.second.count;
+        });
+
+        for (int j = 0; j < std::min(maxPairs, pairs.size()); j += 1) {
+            const auto& e = pairs[j].second;
+            s << "  process " << pairs[j].first.first << " -> process " << pairs[j].first.second << ": " << e.count << " times, delta "
+              << e.minDelta << " .. " << e.maxDelta << " " << deltaUnit(c) << ". e.g. at";
+            foreach (const auto& sample, e.samples) {
+                s << " " << sample.time << " (" << sample.delta << ")";
+            }
+            s << "\n";
+        }
+        if (pairs.size() > maxPairs) {
+            s << "  ... and " << pairs.size() - maxPairs << " more pairs.\n";
+        }
+    }
+
+    s.flush();
+    return ret;
+}
@@ -0,0 +1,57 @@
+#ifndef EDGE_BUNDLING_PROTOTYPE_DIAGNOSTICS_HPP
+#define EDGE_BUNDLING_PROTOTYPE_DIAGNOSTICS_HPP
+
+#include "prereqs.hpp"
+
+#include "rawtrace.hpp"
+
+// Collects the warnings of matching instead of printing one line per message, which was slow for traces with clock skew.
+//
+// Every category is counted per (sender, receiver) pair, together with the min/max delta and the first few samples.
+// Nothing is printed while collecting. toString() summarizes everything at the end.
+// All functions are thread safe. Threads that report a lot should collect into their own instance and merge() it.
+class Diagnostics {
+public:
+    enum class Category {
+        SendAfterReceive, // the send started after the receive (clock skew). delta: receive time - send time, negative
+        ReceiveTooShort,  // the receiver got fewer bytes than were sent. delta: sent - received bytes
+    };
+
+    struct Sample {
+        timestamp_t time; // of the send
+        s64         delta;
+    };
+
+    struct Entry {
+        s64             count    = 0;
+        s64             minDelta = std::numeric_limits<s64>::max();
+        s64             maxDelta = std::numeric_limits<s64>::min();
+        QVector<Sample> samples; // the first ones, at most maxSamples
+    };
+
+    using Key = QPair<int /*Category*/, QPair<process_t /*sender*/, process_t /*receiver*/>>;
+
+public:
+    Diagnostics(int maxSamples = 3);
+    Diagnostics(const Diagnostics& o);
+
+    Diagnostics& operator=(const Diagnostics& o);
+
+    void add(Category c, process_t sender, process_t receiver, timestamp_t time, s64 delta);
+    void merge(const Diagnostics& o);
+    void clear();
+
+    bool             isEmpty()             const;
+    s64              count(Category c)     const; // over all pairs
+    QMap<Key, Entry> entries()             const;
+
+    // one summary line per category, followed by the maxPairs pairs with the most occurrences. empty if there is nothing
+    QString toString(int maxPairs = 10) const;
+
+private:
+    int              _maxSamples;
+    QMap<Key, Entry> _entries;
+    mutable QMutex   _mutex;
+};
+
+#endif // EDGE_BUNDLING_PROTOTYPE_DIAGNOSTICS_HPP
@@ -0,0 +1,18 @@
+TEMPLATE = app
+TARGET   = generator
+
+QT      = core
+CONFIG += c++11 console release
+CONFIG -= app_bundle
+
+# only writes otf2, so neither otf nor the reader are needed
+INCLUDEPATH += \
+	$$PWD/.. \
+	$$system(otf2-config --cflags | sed -e 's/-I//g')
+
+LIBS += \
+	$$system(otf2-config --ldflags) \
+	$$system(otf2-config --libs)
+
+SOURCES += \
+	$$PWD/main.cpp
@@ -0,0 +1,515 @@
+#include "prereqs.hpp"
+
+#include <otf2/otf2.h>
+
+// Writes synthetic otf2 archives, to test RawTrace at scales beyond the bundled traces.
+//
+// Every rank runs the same iterations: compute, the sends of the pattern, the receives of the pattern, and a waitall
+// that completes the non-blocking requests in reverse order. A fraction of sends and receives is non-blocking, and a
+// fraction is followed by an extra request that is cancelled in the waitall. Threads other than the main thread only
+// compute. Locations are numbered like score-p does it: rank r is location r and its thread t is (t << 32) | r, which
+// is what RawTrace expects for the process hierarchy.
+//
+// Random decisions are hashes of the seed and the message, so the expected results are computed while writing,
+// without any state. They are printed as json: e.g. the number of messages toTrace() should match, and how many sends
+// start after their receive because of the clock skew (Diagnostics::Category::SendAfterReceive).
+//
+// Written against the otf2 2.x definition writers, like the reader.
+
+AutoFlushingQTextStream qerr(stderr, QIODevice::WriteOnly);
+AutoFlushingQTextStream qout(stdout, QIODevice::WriteOnly);
+
+enum class Pattern { Halo, AllToAll, MasterWorker };
+
+struct Options {
+    QString directory;
+    QString name;
+    u32     ranks;
+    u32     threads;     // per rank, including the main thread
+    Pattern pattern;
+    u32     iterations;  // every iteration, every rank sends the messages of the pattern once
+    u64     messageSize; // bytes
+    f64     nonblocking; // fraction of sends and receives that are isend/irecv
+    f64     cancel;      // fraction of sends and receives that are followed by a cancelled request
+    s64     skew;        // every rank's clock is off by up to +-skew ticks
+    u64     seed;
+};
+
+struct Expected {
+    u64 events              = 0;
+    u64 messages            = 0; // matched by toTrace()
+    u64 nonblockingSends    = 0;
+    u64 nonblockingReceives = 0;
+    u64 cancelledRequests   = 0;
+    u64 sendsAfterReceive   = 0; // because of the clock skew
+};
+
+// patterns //////////////////////////////////////////////////////////////////
+
+struct Peer {
+    u32 rank;
+    u32 tag;
+};
+
+// halo: a ring. every rank sends to its right (tag 0) and to its left neighbor (tag 1).
+// all-to-all: every rank sends to every other rank, ascending.
+// master/worker: rank 0 sends work to every worker (tag 0), every worker sends its result to rank 0 (tag 1).
+
+// in send order
+static QVector<Peer> destinations(Pattern p, u32 r, u32 ranks) {
+    QVector<Peer> ret;
+    if (ranks < 2) { return ret; }
+    switch (p) {
+    case Pattern::Halo:
+        ret.append(Peer{(r + 1) % ranks, 0});
+        ret.append(Peer{(r + ranks - 1) % ranks, 1});
+        break;
+    case Pattern::AllToAll:
+        for (u32 d = 0; d < ranks; d += 1) {
+            if (d != r) { ret.append(Peer{d, 0}); }
+        }
+        break;
+    case Pattern::MasterWorker:
+        if (r == 0) { for (u32 w = 1; w < ranks; w += 1) { ret.append(Peer{w, 0}); } }
+        else        { ret.append(Peer{0, 1}); }
+        break;
+    }
+    return ret;
+}
+
+// in receive order. sourceSlot() is the index of a message in it
+static QVector<Peer> sources(Pattern p, u32 r, u32 ranks) {
+    QVector<Peer> ret;
+    if (ranks < 2) { return ret; }
+    switch (p) {
+    case Pattern::Halo:
+        ret.append(Peer{(r + ranks - 1) % ranks, 0}); // sent to its right
+        ret.append(Peer{(r + 1) % ranks, 1});         // sent to its left
+        break;
+    case Pattern::AllToAll:
+        for (u32 s = 0; s < ranks; s += 1) {
+            if (s != r) { ret.append(Peer{s, 0}); }
+        }
+        break;
+    case Pattern::MasterWorker:
+        if (r == 0) { for (u32 w = 1; w < ranks; w += 1) { ret.append(Peer{w, 1}); } }
+        else        { ret.append(Peer{0, 0}); }
+        break;
+    }
+    return ret;
+}
+
+static int sourceSlot(Pattern p, u32 receiver, u32 sender, u32 tag) {
+    switch (p) {
+    case Pattern::Halo:         return (int) tag;
+    case Pattern::AllToAll:     return (int) (sender < receiver ? sender : sender - 1);
+    case Pattern::MasterWorker: return receiver == 0 ? (int) sender - 1 : 0;
+    }
+    return 0;
+}
+
+static int maxDestinationCount(Pattern p, u32 ranks) {
+    if (ranks < 2) { return 0; }
+    return p == Pattern::Halo ? 2 : (int) ranks - 1;
+}
+
+static int maxSourceCount(Pattern p, u32 ranks) {
+    return maxDestinationCount(p, ranks);
+}
+
+// decisions /////////////////////////////////////////////////////////////////
+
+enum class Decision : u64 { Skew, NonblockingSend, NonblockingReceive, CancelSend, CancelReceive };
+
+static u64 mix(u64 x) { // splitmix64
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+// uniform in [0, 1)
+static f64 uniform(u64 seed, Decision d, u64 a, u64 b = 0, u64 c = 0, u64 e = 0) {
+    u64 x = mix(seed ^ (u64) d);
+    x = mix(x ^ a);
+    x = mix(x ^ b);
+    x = mix(x ^ c);
+    x = mix(x ^ e);
+    return (x >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static s64 skew(const Options& o, u32 r) {
+    if (o.skew == 0) { return 0; }
+    return (s64) (uniform(o.seed, Decision::Skew, r) * (2 * o.skew + 1)) - o.skew;
+}
+
+static bool nonblockingSend(const Options& o, u32 sender, const Peer& to, u32 iteration) {
+    return uniform(o.seed, Decision::NonblockingSend, sender, to.rank, to.tag, iteration) < o.nonblocking;
+}
+
+static bool nonblockingReceive(const Options& o, u32 receiver, const Peer& from, u32 iteration) {
+    return uniform(o.seed, Decision::NonblockingReceive, receiver, from.rank, from.tag, iteration) < o.nonblocking;
+}
+
+static bool cancelAfterSend(const Options& o, u32 sender, const Peer& to, u32 iteration) {
+    return uniform(o.seed, Decision::CancelSend, sender, to.rank, to.tag, iteration) < o.cancel;
+}
+
+static bool cancelAfterReceive(const Options& o, u32 receiver, const Peer& from, u32 iteration) {
+    return uniform(o.seed, Decision::CancelReceive, receiver, from.rank, from.tag, iteration) < o.cancel;
+}
+
+// timing ////////////////////////////////////////////////////////////////////
+
+// tick offsets within an iteration, the same for every rank. without skew every receive is after its send.
+// all records of a location are in time order.
+struct Layout {
+    static const s64 slot        = 10; // per send or receive, including a cancelled request
+    static const s64 computeTime = 1000;
+
+    int maxDestinations;
+    int maxSources;
+    s64 sendBegin;
+    s64 receiveBegin;
+    s64 waitBegin;
+    s64 length;
+    s64 origin; // of iteration 0, so that skewed times are not negative
+
+    Layout(const Options& o) {
+        maxDestinations = maxDestinationCount(o.pattern, o.ranks);
+        maxSources      = maxSourceCount     (o.pattern, o.ranks);
+        sendBegin       = computeTime + slot;
+        receiveBegin    = sendBegin    + maxDestinations * slot;
+        waitBegin       = receiveBegin + maxSources      * slot;
+        length          = waitEnd() + slot;
+        origin          = o.skew;
+    }
+
+    s64 iterationBegin(const Options& o, u32 r, u32 i) const { return origin + skew(o, r) + i * length; }
+
+    // within the iteration. the waitall completes the irecvs, then the isends, in reverse, then the cancelled requests
+    s64 sendTime            (int k)    const { return sendBegin    + k * slot + 1; } // send and isend
+    s64 receiveTime         (int k)    const { return receiveBegin + k * slot + 1; } // recv and irecv request
+    s64 irecvCompleteTime   (int k)    const { return waitBegin + 1 + (maxSources - 1 - k) * slot; }
+    s64 isendCompleteTime   (int k)    const { return waitBegin + 1 + (maxSources + maxDestinations - 1 - k) * slot; }
+    s64 sendCancelledTime   (int k)    const { return waitBegin + 1 + (maxSources + maxDestinations + k) * slot; }
+    s64 receiveCancelledTime(int k)    const { return waitBegin + 1 + (maxSources + 2 * maxDestinations + k) * slot; }
+    s64 waitEnd             ()         const { return waitBegin + 1 + 2 * (maxSources + maxDestinations) * slot; }
+};
+
+// writing ///////////////////////////////////////////////////////////////////
+
+enum Region  : OTF2_RegionRef { Compute, MpiSend, MpiIsend, MpiRecv, MpiIrecv, MpiWaitall };
+enum String  : OTF2_StringRef { Empty, ComputeName, MpiSendName, MpiIsendName, MpiRecvName, MpiIrecvName, MpiWaitallName, CommWorldName, MachineName, NodeName, FirstRankName };
+
+static const OTF2_CommRef  commWorld      = 0;
+static const OTF2_GroupRef locationsGroup = 0; // rank -> location
+static const OTF2_GroupRef commWorldGroup = 1;
+
+static void check(OTF2_ErrorCode e) {
+    if (e != OTF2_SUCCESS) {
+        qerr << "otf2 error: " << OTF2_Error_GetName(e) << ": " << OTF2_Error_GetDescription(e) << ". aborting.\n";
+        exit(1);
+    }
+}
+
+static OTF2_FlushType preFlush(void* userData, OTF2_FileType fileType, OTF2_LocationRef location, void* callerData, bool final) {
+    (void) userData; (void) fileType; (void) location; (void) callerData; (void) final;
+    return OTF2_FLUSH;
+}
+
+static OTF2_TimeStamp postFlush(void* userData, OTF2_FileType fileType, OTF2_LocationRef location) {
+    (void) userData; (void) fileType; (void) location;
+    return 0;
+}
+
+static OTF2_FlushCallbacks flushCallbacks = { &preFlush, &postFlush };
+
+static OTF2_LocationRef location(u32 rank, u32 thread) {
+    return ((OTF2_LocationRef) thread << 32) | rank;
+}
+
+static void writeThreadEvents(const Options& o, const Layout& l, u32 r, OTF2_EvtWriter* w) {
+    for (u32 i = 0; i < o.iterations; i += 1) {
+        s64 t = l.iterationBegin(o, r, i);
+        check(OTF2_EvtWriter_Enter(w, nullptr, t,                 Compute));
+        check(OTF2_EvtWriter_Leave(w, nullptr, t + l.computeTime, Compute));
+    }
+}
+
+static void writeRankEvents(const Options& o, const Layout& l, u32 r, OTF2_EvtWriter* w, Expected* expected) {
+    const auto to   = destinations(o.pattern, r, o.ranks);
+    const auto from = sources     (o.pattern, r, o.ranks);
+
+    u64 nextRequest = 0;
+    QVector<u64> isends   (to  .size()), sendCancels   (to  .size()); // request ids of this iteration, 0 is none
+    QVector<u64> irecvs   (from.size()), receiveCancels(from.size());
+
+    for (u32 i = 0; i < o.iterations; i += 1) {
+        s64 t = l.iterationBegin(o, r, i);
+
+        check(OTF2_EvtWriter_Enter(w, nullptr, t,                 Compute));
+        check(OTF2_EvtWriter_Leave(w, nullptr, t + l.computeTime, Compute));
+
+        for (int k = 0; k < to.size(); k += 1) {
+            const auto& d = to[k];
+            s64 sendTime = t + l.sendTime(k);
+
+            isends[k] = 0;
+            if (nonblockingSend(o, r, d, i)) {
+                isends[k] = ++nextRequest;
+                check(OTF2_EvtWriter_Enter   (w, nullptr, sendTime - 1, MpiIsend));
+                check(OTF2_EvtWriter_MpiIsend(w, nullptr, sendTime, d.rank, commWorld, d.tag, o.messageSize, isends[k]));
+                check(OTF2_EvtWriter_Leave   (w, nullptr, sendTime + 1, MpiIsend));
+                expected->nonblockingSends += 1;
+            } else {
+                check(OTF2_EvtWriter_Enter  (w, nullptr, sendTime - 1, MpiSend));
+                check(OTF2_EvtWriter_MpiSend(w, nullptr, sendTime, d.rank, commWorld, d.tag, o.messageSize));
+                check(OTF2_EvtWriter_Leave  (w, nullptr, sendTime + 1, MpiSend));
+            }
+
+            sendCancels[k] = 0;
+            if (cancelAfterSend(o, r, d, i)) { // a send that never happens
+                sendCancels[k] = ++nextRequest;
+                check(OTF2_EvtWriter_Enter   (w, nullptr, sendTime + 2, MpiIsend));
+                check(OTF2_EvtWriter_MpiIsend(w, nullptr, sendTime + 3, d.rank, commWorld, d.tag, o.messageSize, sendCancels[k]));
+                check(OTF2_EvtWriter_Leave   (w, nullptr, sendTime + 4, MpiIsend));
+                expected->cancelledRequests += 1;
+            }
+
+            // the receiver's side of this message, for the expected results
+            int receiveSlot = sourceSlot(o.pattern, d.rank, r, d.tag);
+            const Peer self{r, d.tag};
+            s64 receiveTime = l.iterationBegin(o, d.rank, i) + (nonblockingReceive(o, d.rank, self, i) ? l.irecvCompleteTime(receiveSlot) : l.receiveTime(receiveSlot));
+
+            expected->messages += 1;
+            if (sendTime > receiveTime) { expected->sendsAfterReceive += 1; }
+        }
+
+        for (int k = 0; k < from.size(); k += 1) {
+            const auto& s = from[k];
+            s64 receiveTime = t + l.receiveTime(k);
+
+            irecvs[k] = 0;
+            if (nonblockingReceive(o, r, s, i)) {
+                irecvs[k] = ++nextRequest;
+                check(OTF2_EvtWriter_Enter          (w, nullptr, receiveTime - 1, MpiIrecv));
+                check(OTF2_EvtWriter_MpiIrecvRequest(w, nullptr, receiveTime, irecvs[k]));
+                check(OTF2_EvtWriter_Leave          (w, nullptr, receiveTime + 1, MpiIrecv));
+                expected->nonblockingReceives += 1;
+            } else {
+                check(OTF2_EvtWriter_Enter  (w, nullptr, receiveTime - 1, MpiRecv));
+                check(OTF2_EvtWriter_MpiRecv(w, nullptr, receiveTime, s.rank, commWorld, s.tag, o.messageSize));
+                check(OTF2_EvtWriter_Leave  (w, nullptr, receiveTime + 1, MpiRecv));
+            }
+
+            receiveCancels[k] = 0;
+            if (cancelAfterReceive(o, r, s, i)) {
+                receiveCancels[k] = ++nextRequest;
+                check(OTF2_EvtWriter_Enter          (w, nullptr, receiveTime + 2, MpiIrecv));
+                check(OTF2_EvtWriter_MpiIrecvRequest(w, nullptr, receiveTime + 3, receiveCancels[k]));
+                check(OTF2_EvtWriter_Leave          (w, nullptr, receiveTime + 4, MpiIrecv));
+                expected->cancelledRequests += 1;
+            }
+        }
+
+        // waitall, see Layout
+        check(OTF2_EvtWriter_Enter(w, nullptr, t + l.waitBegin, MpiWaitall));
+        for (int k = from.size() - 1; k >= 0; k -= 1) {
+            if (irecvs[k] == 0) { continue; }
+            check(OTF2_EvtWriter_MpiIrecv(w, nullptr, t + l.irecvCompleteTime(k), from[k].rank, commWorld, from[k].tag, o.messageSize, irecvs[k]));
+        }
+        for (int k = to.size() - 1; k >= 0; k -= 1) {
+            if (isends[k] == 0) { continue; }
+            check(OTF2_EvtWriter_MpiIsendComplete(w, nullptr, t + l.isendCompleteTime(k), isends[k]));
+        }
+        for (int k = 0; k < to.size(); k += 1) {
+            if (sendCancels[k] == 0) { continue; }
+            check(OTF2_EvtWriter_MpiRequestCancelled(w, nullptr, t + l.sendCancelledTime(k), sendCancels[k]));
+        }
+        for (int k = 0; k < from.size(); k += 1) {
+            if (receiveCancels[k] == 0) { continue; }
+            check(OTF2_EvtWriter_MpiRequestCancelled(w, nullptr, t + l.receiveCancelledTime(k), receiveCancels[k]));
+        }
+        check(OTF2_EvtWriter_Leave(w, nullptr, t + l.waitEnd(), MpiWaitall));
+    }
+}
+
+static void writeGlobalDefinitions(const Options& o, const Layout& l, const QVector<u64>& eventCounts, OTF2_GlobalDefWriter* w) {
+    s64 traceLength = l.origin + o.skew + o.iterations * l.length + 1;
+    check(OTF2_GlobalDefWriter_WriteClockProperties(w, 1000000000, 0, traceLength)); // ticks are nanoseconds
+
+    const QList<QPair<OTF2_StringRef, const char*>> strings = {
+        {Empty, ""}, {ComputeName, "compute"}, {MpiSendName, "MPI_Send"}, {MpiIsendName, "MPI_Isend"}, {MpiRecvName, "MPI_Recv"},
+        {MpiIrecvName, "MPI_Irecv"}, {MpiWaitallName, "MPI_Waitall"}, {CommWorldName, "MPI_COMM_WORLD"}, {MachineName, "machine"}, {NodeName, "node"},
+    };
+    for (const auto& s : strings) {
+        check(OTF2_GlobalDefWriter_WriteString(w, s.first, s.second));
+    }
+    for (u32 r = 0; r < o.ranks; r += 1) {
+        check(OTF2_GlobalDefWriter_WriteString(w, FirstRankName + r, QString("rank %1").arg(r).toUtf8().constData()));
+    }
+    const OTF2_StringRef firstThreadName = FirstRankName + o.ranks;
+    for (u32 t = 1; t < o.threads; t += 1) {
+        check(OTF2_GlobalDefWriter_WriteString(w, firstThreadName + t, QString("thread %1").arg(t).toUtf8().constData()));
+    }
+
+    const QList<QPair<OTF2_StringRef, bool /*mpi*/>> regions = {
+        {ComputeName, false}, {MpiSendName, true}, {MpiIsendName, true}, {MpiRecvName, true}, {MpiIrecvName, true}, {MpiWaitallName, true},
+    };
+    for (int i = 0; i < regions.size(); i += 1) {
+        auto name = regions[i].first;
+        bool mpi  = regions[i].second;
+        check(OTF2_GlobalDefWriter_WriteRegion(w, (OTF2_RegionRef) i, name, name, Empty, mpi ? OTF2_REGION_ROLE_POINT2POINT : OTF2_REGION_ROLE_FUNCTION,
+                                               mpi ? OTF2_PARADIGM_MPI : OTF2_PARADIGM_USER, OTF2_REGION_FLAG_NONE, Empty, 0, 0));
+    }
+
+    check(OTF2_GlobalDefWriter_WriteSystemTreeNode(w, 0, MachineName, NodeName, OTF2_UNDEFINED_SYSTEM_TREE_NODE));
+
+    for (u32 r = 0; r < o.ranks; r += 1) {
+        check(OTF2_GlobalDefWriter_WriteLocationGroup(w, r, FirstRankName + r, OTF2_LOCATION_GROUP_TYPE_PROCESS, 0));
+    }
+
+    for (u32 r = 0; r < o.ranks; r += 1) {
+        for (u32 t = 0; t < o.threads; t += 1) {
+            check(OTF2_GlobalDefWriter_WriteLocation(w, location(r, t), t == 0 ? FirstRankName + r : firstThreadName + t, OTF2_LOCATION_TYPE_CPU_THREAD,
+                                                     eventCounts[(int) (r * o.threads + t)], r));
+        }
+    }
+
+    std::vector<uint64_t> locations(o.ranks), ranks(o.ranks);
+    for (u32 r = 0; r < o.ranks; r += 1) {
+        locations[r] = location(r, 0);
+        ranks[r]     = r;
+    }
+    check(OTF2_GlobalDefWriter_WriteGroup(w, locationsGroup, Empty,         OTF2_GROUP_TYPE_COMM_LOCATIONS, OTF2_PARADIGM_MPI, OTF2_GROUP_FLAG_NONE, o.ranks, locations.data()));
+    check(OTF2_GlobalDefWriter_WriteGroup(w, commWorldGroup, CommWorldName, OTF2_GROUP_TYPE_COMM_GROUP,     OTF2_PARADIGM_MPI, OTF2_GROUP_FLAG_NONE, o.ranks, ranks.data()));
+
+    check(OTF2_GlobalDefWriter_WriteComm(w, commWorld, CommWorldName, commWorldGroup, OTF2_UNDEFINED_COMM));
+}
+
+static Expected write(const Options& o) {
+    Layout l(o);
+    Expected expected;
+
+    OTF2_Archive* archive = OTF2_Archive_Open(o.directory.toUtf8().constData(), o.name.toUtf8().constData(), OTF2_FILEMODE_WRITE,
+                                              1024 * 1024 /*event chunk size*/, 4 * 1024 * 1024 /*definition chunk size*/, OTF2_SUBSTRATE_POSIX, OTF2_COMPRESSION_NONE);
+    if (archive == nullptr) {
+        qerr << "could not create \"" << o.directory << "/" << o.name << ".otf2\". aborting.\n";
+        exit(1);
+    }
+
+    check(OTF2_Archive_SetFlushCallbacks(archive, &flushCallbacks, nullptr));
+    check(OTF2_Archive_SetSerialCollectiveCallbacks(archive));
+
+    // one location at a time, so that only one event file is open
+    QVector<u64> eventCounts((int) (o.ranks * o.threads));
+
+    check(OTF2_Archive_OpenEvtFiles(archive));
+    for (u32 r = 0; r < o.ranks; r += 1) {
+        for (u32 t = 0; t < o.threads; t += 1) {
+            OTF2_EvtWriter* w = OTF2_Archive_GetEvtWriter(archive, location(r, t));
+            if (w == nullptr) {
+                qerr << "could not create the event writer of location " << location(r, t) << ". aborting.\n";
+                exit(1);
+            }
+
+            if (t == 0) { writeRankEvents  (o, l, r, w, &expected); }
+            else        { writeThreadEvents(o, l, r, w);            }
+
+            uint64_t n = 0;
+            check(OTF2_EvtWriter_GetNumberOfEvents(w, &n));
+            eventCounts[(int) (r * o.threads + t)] = n;
+            expected.events += n;
+
+            check(OTF2_Archive_CloseEvtWriter(archive, w));
+        }
+    }
+    check(OTF2_Archive_CloseEvtFiles(archive));
+
+    // empty local definitions, the reader opens them
+    check(OTF2_Archive_OpenDefFiles(archive));
+    for (u32 r = 0; r < o.ranks; r += 1) {
+        for (u32 t = 0; t < o.threads; t += 1) {
+            OTF2_DefWriter* w = OTF2_Archive_GetDefWriter(archive, location(r, t));
+            check(OTF2_Archive_CloseDefWriter(archive, w));
+        }
+    }
+    check(OTF2_Archive_CloseDefFiles(archive));
+
+    OTF2_GlobalDefWriter* w = OTF2_Archive_GetGlobalDefWriter(archive);
+    writeGlobalDefinitions(o, l, eventCounts, w);
+
+    check(OTF2_Archive_Close(archive));
+
+    return expected;
+}
+
+int main(int argc, char** argv) {
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Writes a synthetic otf2 archive <directory>/<name>.otf2 and prints the expected results as json.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("directory", "Where to create the archive. Must not contain one with the same name.");
+
+    QCommandLineOption nameOption       ("name",         "Archive name. Default traces.",                                                  "name", "traces");
+    QCommandLineOption ranksOption      ("ranks",        "MPI ranks. Default 1024.",                                                       "n",    "1024"  );
+    QCommandLineOption threadsOption    ("threads",      "Threads per rank, including the main thread. Default 1.",                        "n",    "1"     );
+    QCommandLineOption patternOption    ("pattern",      "halo, all-to-all or master-worker. Default halo.",                               "p",    "halo"  );
+    QCommandLineOption iterationsOption ("iterations",   "Iterations. Each sends every message of the pattern once. Default 10.",          "n",    "10"    );
+    QCommandLineOption messageSizeOption("message-size", "Bytes per message. Default 1024.",                                               "n",    "1024"  );
+    QCommandLineOption nonblockingOption("nonblocking",  "Fraction of sends and receives that are MPI_Isend/MPI_Irecv. Default 0.5.",      "f",    "0.5"   );
+    QCommandLineOption cancelOption     ("cancel",       "Fraction of sends and receives followed by a cancelled request. Default 0.05.", "f",    "0.05"  );
+    QCommandLineOption skewOption       ("skew",         "Every rank's clock is off by up to +-skew ticks (ns). Default 0.",               "n",    "0"     );
+    QCommandLineOption seedOption       ("seed",         "Seed of the random decisions. Default 1.",                                       "n",    "1"     );
+    parser.addOptions({nameOption, ranksOption, threadsOption, patternOption, iterationsOption, messageSizeOption, nonblockingOption, cancelOption, skewOption, seedOption});
+
+    parser.process(app);
+
+    if (parser.positionalArguments().size() != 1) {
+        parser.showHelp(2);
+    }
+
+    const QMap<QString, Pattern> patterns = {{"halo", Pattern::Halo}, {"all-to-all", Pattern::AllToAll}, {"master-worker", Pattern::MasterWorker}};
+
+    Options o;
+    o.directory   = parser.positionalArguments().first();
+    o.name        = parser.value(nameOption);
+    o.ranks       = parser.value(ranksOption)      .toUInt();
+    o.threads     = parser.value(threadsOption)    .toUInt();
+    o.pattern     = patterns.value(parser.value(patternOption), Pattern::Halo);
+    o.iterations  = parser.value(iterationsOption) .toUInt();
+    o.messageSize = parser.value(messageSizeOption).toULongLong();
+    o.nonblocking = parser.value(nonblockingOption).toDouble();
+    o.cancel      = parser.value(cancelOption)     .toDouble();
+    o.skew        = parser.value(skewOption)       .toLongLong();
+    o.seed        = parser.value(seedOption)       .toULongLong();
+
+    if (o.ranks == 0 || o.threads == 0 || patterns.contains(parser.value(patternOption)) == false || o.nonblocking < 0 || o.nonblocking > 1
+            || o.cancel < 0 || o.cancel > 1 || o.skew < 0 || o.name.isEmpty()) {
+        qerr << "invalid arguments. see --help\n";
+        return 2;
+    }
+
+    auto e = write(o);
+
+    QJsonObject summary{
+        {"archive",             QDir(o.directory).filePath(o.name + ".otf2")},
+        {"ranks",               (qint64) o.ranks},
+        {"threads",             (qint64) o.threads},
+        {"locations",           (qint64) o.ranks * o.threads},
+        {"pattern",             parser.value(patternOption)},
+        {"iterations",          (qint64) o.iterations},
+        {"seed",                QString::number(o.seed)},
+        {"events",              (qint64) e.events},
+        {"messages",            (qint64) e.messages},
+        {"nonblockingSends",    (qint64) e.nonblockingSends},
+        {"nonblockingReceives", (qint64) e.nonblockingReceives},
+        {"cancelledRequests",   (qint64) e.cancelledRequests},
+        {"sendsAfterReceive",   (qint64) e.sendsAfterReceive},
+    };
+    qout << QJsonDocument(summary).toJson();
+
+    return 0;
+}
@@ -0,0 +1,154 @@
+#include "lazytrace.hpp"
+
+LazyTrace::LazyTrace(const QString& traceFileName, s64 memoryBudget) : _memoryBudget(memoryBudget) {
+    assert(memoryBudget >= 0);
+    _rawTrace.setTraceFileName(traceFileName);
+    _rawTrace.loadDefinitions();
+}
+
+RawTrace& LazyTrace::rawTrace() {
+    return _rawTrace;
+}
+
+const QSet<process_t>& LazyTrace::processes() const {
+    return _rawTrace.processes();
+}
+
+const QMap<process_t, QString>& LazyTrace::processNames() const {
+    return _rawTrace.processNames();
+}
+
+const QMap<process_t, process_t>& LazyTrace::processParents() const {
+    return _rawTrace.processParents();
+}
+
+static Trace::MessageList view(const RawTrace::SenderMatches& m) {
+    return Trace::MessageList(m.time.constData(), m.duration.constData(), m.receiver.constData(), m.length.constData(), m.time.size());
+}
+
+Trace::MessageList LazyTrace::messages(process_t p) {
+    assert(processes().contains(p));
+
+    Entry e((int) Kind::Messages, p);
+
+    auto cached = _messages.constFind(p);
+    if (cached != _messages.constEnd()) {
+        touch(e, 0);
+        return view(cached.value());
+    }
+
+    loadEvents(QSet<process_t>{p});
+
+    QSet<process_t> receivers;
+    for (const auto& s : _rawTrace.sentMessages(p)) {
+        if (processes().contains(s.receiver)) { receivers.insert(s.receiver); }
+    }
+    loadEvents(receivers);
+
+    RawTrace::SenderMatches m;
+    Diagnostics d;
+    _rawTrace.matchSends(p, &m, &d);
+
+    if (_matched.contains(p) == false) {
+        _matched.insert(p);
+        _diagnostics.merge(d);
+        QMapIterator<RawTrace::MessageKey, int> i(m.missingReceives);
+        while (i.hasNext()) {
+            i.next();
+            _missingReceives[i.key()] += i.value();
+        }
+    }
+    m.missingReceives.clear();
+
+    // sends of one process are recorded in time order, so this is usually a no-op
+    if (std::is_sorted(m.time.constBegin(), m.time.constEnd()) == false) {
+        QVector<s64> order(m.time.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&m](s64 a, s64 b) { return m.time[(int) a] < m.time[(int) b]; });
+
+        permute(m.time    .data(), order, 0);
+        permute(m.duration.data(), order, 0);
+        permute(m.receiver.data(), order, 0);
+        permute(m.length  .data(), order, 0);
+    }
+
+    s64 bytes = m.time.size() * (s64) (2*sizeof(timestamp_t) + sizeof(processindex_t) + sizeof(messagelength_t));
+
+    _messages[p] = std::move(m);
+    touch(e, bytes);
+    evict(e);
+
+    return view(_messages[p]);
+}
+
+const Diagnostics& LazyTrace::diagnostics() const {
+    return _diagnostics;
+}
+
+const QMap<RawTrace::MessageKey, int>& LazyTrace::missingReceives() const {
+    return _missingReceives;
+}
+
+void LazyTrace::setMemoryBudget(s64 bytes) {
+    assert(bytes >= 0);
+    _memoryBudget = bytes;
+    evict(Entry(-1, -1));
+}
+
+s64 LazyTrace::memoryBudget() const {
+    return _memoryBudget;
+}
+
+s64 LazyTrace::residentBytes() const {
+    return _residentBytes;
+}
+
+// marks e as most recently used. bytes is only used if e is new
+void LazyTrace::touch(const Entry& e, s64 bytes) {
+    auto it = _lastUse.constFind(e);
+    if (it != _lastUse.constEnd()) {
+        _lru.remove(it.value());
+    } else {
+        _entryBytes[e]  = bytes;
+        _residentBytes += bytes;
+    }
+
+    _useCount += 1;
+    _lastUse[e]     = _useCount;
+    _lru[_useCount] = e;
+}
+
+// drops least recently used entries except keep until the budget is met
+void LazyTrace::evict(const Entry& keep) {
+    auto i = _lru.begin();
+    while (_residentBytes > _memoryBudget && i != _lru.end()) {
+        if (i.value() == keep) { ++i; continue; }
+
+        Entry e = i.value();
+        i = _lru.erase(i);
+
+        _lastUse.remove(e);
+        _residentBytes -= _entryBytes.take(e);
+
+        if ((Kind) e.first == Kind::Events) { _rawTrace.unloadEvents(e.second); }
+        else                                { _messages.remove(e.second);       }
+    }
+}
+
+void LazyTrace::loadEvents(const QSet<process_t>& ps) {
+    QSet<process_t> toLoad;
+    foreach (auto p, ps) {
+        Entry e((int) Kind::Events, p);
+        if (_lastUse.contains(e)) { touch(e, 0); }
+        else                      { toLoad.insert(p); }
+    }
+
+    if (toLoad.isEmpty()) { return; }
+
+    _rawTrace.loadEvents(toLoad);
+
+    foreach (auto p, toLoad) {
+        s64 bytes = _rawTrace.sentMessages(p).size() * (s64) sizeof(RawTrace::SentMessage) + _rawTrace.receivedMessages(p).size() * (s64) sizeof(RawTrace::ReceivedMessage);
+        touch(Entry((int) Kind::Events, p), bytes);
+    }
+}
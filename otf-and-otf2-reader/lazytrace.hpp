@@ -0,0 +1,72 @@
+#ifndef EDGE_BUNDLING_PROTOTYPE_LAZYTRACE_HPP
+#define EDGE_BUNDLING_PROTOTYPE_LAZYTRACE_HPP
+
+#include "prereqs.hpp"
+
+#include "diagnostics.hpp"
+#include "rawtrace.hpp"
+#include "trace.hpp"
+
+// Alternative to Trace for looking at a few processes of a huge trace.
+//
+// messages(p) reads the events of p and of every process p sends to, and matches p's sends on first access, the same
+// way as RawTrace::toTrace().
+// The read events and the matched messages stay resident until the memory budget is exceeded. Then the least recently
+// used ones are dropped and reread if needed again.
+// Only the messages are lazy. Definitions are read by the constructor. Not thread safe.
+class LazyTrace {
+public:
+    LazyTrace(const QString& traceFileName, s64 memoryBudget /*bytes*/);
+    LazyTrace(const LazyTrace&) = delete;
+    LazyTrace(LazyTrace&&)      = delete;
+
+    LazyTrace& operator=(const LazyTrace&) = delete;
+    LazyTrace& operator=(LazyTrace&&)      = delete;
+
+    RawTrace& rawTrace(); // e.g. to set threads or the filter before the first messages(). no streaming matching
+
+    const QSet<process_t>&            processes()      const;
+    const QMap<process_t, QString>&   processNames()   const;
+    const QMap<process_t, process_t>& processParents() const;
+
+    // sorted by time, like Trace::messages(). valid until the messages of p are evicted, i.e. until the next messages()
+    // or setMemoryBudget() call
+    Trace::MessageList messages(process_t p);
+
+    // warnings and sends without receive of the senders matched so far. every sender counts once, even if it is
+    // matched again after being evicted
+    const Diagnostics&                               diagnostics()     const;
+    const QMap<RawTrace::MessageKey, int /*count*/>& missingReceives() const;
+
+    void setMemoryBudget(s64 bytes); // evicts right away if needed
+    s64  memoryBudget()  const;
+    s64  residentBytes() const;      // approximate: the size of the stored records, without container overhead
+
+private:
+    enum class Kind { Events, Messages };
+    using Entry = QPair<int /*Kind*/, process_t>;
+
+    RawTrace _rawTrace;
+
+    QHash<process_t, RawTrace::SenderMatches> _messages; // sorted by time, without missingReceives
+
+    QSet<process_t>                           _matched;  // senders whose diagnostics and missing receives are counted
+    Diagnostics                               _diagnostics;
+    QMap<RawTrace::MessageKey, int /*count*/> _missingReceives;
+
+    s64 _memoryBudget;
+    s64 _residentBytes = 0;
+
+    // lru: entries ordered by last use
+    u64                _useCount = 0;
+    QHash<Entry, u64>  _lastUse;
+    QMap<u64, Entry>   _lru;
+    QHash<Entry, s64>  _entryBytes;
+
+private:
+    void touch(const Entry& e, s64 bytes);
+    void evict(const Entry& keep);
+    void loadEvents(const QSet<process_t>& ps);
+};
+
+#endif // EDGE_BUNDLING_PROTOTYPE_LAZYTRACE_HPP
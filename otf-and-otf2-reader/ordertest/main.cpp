@@ -0,0 +1,105 @@
+#include "prereqs.hpp"
+
+#include "rawtrace.hpp"
+
+// Checks RawTrace::orderedProcesses() against the original recursive, quadratic implementation on the bundled traces
+// (or the given ones). Only the definitions are read. Exit code 1 if any order differs. `make check` runs it.
+
+AutoFlushingQTextStream qerr(stderr, QIODevice::WriteOnly);
+AutoFlushingQTextStream qout(stdout, QIODevice::WriteOnly);
+
+static QStringList bundledTraces() {
+    QDir d(ORDERTEST_TRACE_DIR);
+    return QStringList{
+        d.filePath("lulesh-016p-2-iterations/lulesh-trace.otf"),
+        d.filePath("tachyon-253p/tachyon_base.none_copy.otf"),
+        d.filePath("fd4-01024p/a.otf"),
+        d.filePath("vampir.eu-example-large/wrf.otf"),
+    };
+}
+
+// Vampir Master Timeline order as the reader determined it before it was made iterative
+static QList<process_t> orderProcessesReference(const QSet<process_t>& processes, const QMap<process_t, process_t>& parents) {
+    QList<process_t> ret;
+
+    QMap<process_t, QList<process_t>> children; // will be the reverse mapping of processParents
+
+    QMapIterator<process_t, process_t> i(parents);
+    while (i.hasNext()) {
+        i.next();
+        children[i.value()].append(i.key());
+    }
+
+    // sort children lists
+    QMutableMapIterator<process_t, QList<process_t>> j(children);
+    while (j.hasNext()) {
+        j.next();
+        std::sort(j.value().begin(), j.value().end());
+    }
+
+    auto sortedProcesses = processes.toList(); // QSet is unordered. We need them ordered.
+    std::sort(sortedProcesses.begin(), sortedProcesses.end());
+
+    QSet<process_t> added;
+
+    // Add process ids to orderedProcesses recursively. Children might be parents of other processes themselves.
+    std::function<void(process_t)> recurse = [&recurse, &sortedProcesses, &children, &added, &ret](process_t parent) {
+        foreach (process_t p, sortedProcesses) {
+            if (added.contains(p) || children.contains(parent) == false) { continue; }
+            if (children[parent].contains(p) == false) { continue; }
+            ret.append(p);
+            added.insert(p);
+
+            recurse(p);
+        }
+    };
+
+    foreach (process_t p, sortedProcesses) {
+        if (added.contains(p)) { continue; }
+        ret.append(p);
+        added.insert(p);
+
+        recurse(p);
+    }
+
+    return ret;
+}
+
+int main(int argc, char** argv) {
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Compares the process order with the original implementation. Without arguments the bundled traces are used.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("traces", "otf or otf2 anchor files", "[trace...]");
+    parser.process(app);
+
+    auto traces = parser.positionalArguments().isEmpty() ? bundledTraces() : parser.positionalArguments();
+
+    int failures = 0;
+    foreach (const auto& trace, traces) {
+        if (QFileInfo(trace).exists() == false) {
+            qerr << "trace \"" << trace << "\" does not exist\n";
+            return 2;
+        }
+
+        RawTrace r;
+        r.setTraceFileName(trace);
+        r.loadDefinitions();
+
+        auto expected = orderProcessesReference(r.processes(), r.processParents());
+        const auto& actual = r.orderedProcesses();
+
+        if (actual == expected) {
+            qout << "ok   " << trace << " (" << actual.size() << " processes)\n";
+            continue;
+        }
+
+        failures += 1;
+        int i = 0;
+        while (i < actual.size() && i < expected.size() && actual[i] == expected[i]) { i += 1; }
+        qout << "FAIL " << trace << ": first difference at index " << i << " of " << expected.size() << "\n";
+    }
+
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,16 @@
+TEMPLATE = app
+TARGET   = ordertest
+
+QT      = core
+CONFIG += c++11 console testcase
+CONFIG -= app_bundle
+
+include(../trace.pri)
+
+INCLUDEPATH += $$PWD/..
+
+# the bundled traces live next to the reader
+DEFINES += ORDERTEST_TRACE_DIR=\\\"$$clean_path($$PWD/../..)\\\"
+
+SOURCES += \
+	$$PWD/main.cpp
@@ -0,0 +1,101 @@
+#include "prereqs.hpp"
+
+#include "rawtrace.hpp"
+#include "trace.hpp"
+
+// Checks that toPartialTrace() leaves the streaming matcher alone: the bundled traces (or the given ones) are loaded in
+// batches with streaming matching and a partial trace after every batch, like AsyncTraceLoader does. The final toTrace()
+// must have the same messages as without streaming matching. Exit code 1 if any trace differs. `make check` runs it.
+
+AutoFlushingQTextStream qerr(stderr, QIODevice::WriteOnly);
+AutoFlushingQTextStream qout(stdout, QIODevice::WriteOnly);
+
+static QStringList bundledTraces() {
+    QDir d(PARTIALTEST_TRACE_DIR);
+    return QStringList{
+        d.filePath("lulesh-016p-2-iterations/lulesh-trace.otf"),
+        d.filePath("tachyon-253p/tachyon_base.none_copy.otf"),
+        d.filePath("fd4-01024p/a.otf"),
+        d.filePath("vampir.eu-example-large/wrf.otf"),
+    };
+}
+
+static const int batchCount = 4;
+
+// index of the first differing message, -1 if there is none
+static s64 firstDifference(const Trace::MessageList& a, const Trace::MessageList& b) {
+    for (s64 i = 0; i < std::min(a.size(), b.size()); i += 1) {
+        auto x = a[i];
+        auto y = b[i];
+        if (x.time != y.time || x.duration != y.duration || x.receiver != y.receiver || x.length != y.length) { return i; }
+    }
+    return a.size() == b.size() ? -1 : std::min(a.size(), b.size());
+}
+
+int main(int argc, char** argv) {
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Compares streaming matching with partial traces in between to plain matching. Without arguments the bundled traces are used.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("traces", "otf or otf2 anchor files", "[trace...]");
+    parser.process(app);
+
+    auto traces = parser.positionalArguments().isEmpty() ? bundledTraces() : parser.positionalArguments();
+
+    int failures = 0;
+    foreach (const auto& trace, traces) {
+        if (QFileInfo(trace).exists() == false) {
+            qerr << "trace \"" << trace << "\" does not exist\n";
+            return 2;
+        }
+
+        Trace expected;
+        {
+            RawTrace r;
+            r.setTraceFileName(trace);
+            r.setPrintDiagnostics(false);
+            r.loadDefinitions();
+            r.loadEvents();
+            r.toTrace(&expected);
+        }
+
+        Trace actual;
+        s64   partialMessages = 0; // of the last partial trace
+        {
+            RawTrace r;
+            r.setTraceFileName(trace);
+            r.setPrintDiagnostics(false);
+            r.setStreamingMatching(true);
+            r.loadDefinitions();
+
+            auto processes = r.processes().toList();
+            std::sort(processes.begin(), processes.end());
+            int batchSize = std::max(1, (processes.size() + batchCount - 1) / batchCount);
+
+            for (int i = 0; i < processes.size(); i += batchSize) {
+                r.loadEvents(processes.mid(i, batchSize).toSet());
+                Trace partial;
+                r.toPartialTrace(&partial);
+                partialMessages = partial.allMessages().size();
+            }
+
+            r.toTrace(&actual);
+        }
+
+        s64 i = firstDifference(actual.allMessages(), expected.allMessages());
+        if (i == -1 && partialMessages == expected.allMessages().size()) {
+            qout << "ok   " << trace << " (" << expected.allMessages().size() << " messages)\n";
+            continue;
+        }
+
+        failures += 1;
+        if (i != -1) {
+            qout << "FAIL " << trace << ": " << actual.allMessages().size() << " messages instead of " << expected.allMessages().size() << ", first difference at index " << i << "\n";
+        } else {
+            qout << "FAIL " << trace << ": the last partial trace has " << partialMessages << " messages instead of " << expected.allMessages().size() << "\n";
+        }
+    }
+
+    return failures > 0 ? 1 : 0;
+}
@@ -2,10 +2,20 @@
 #define EDGE_BUNDLING_PROTOTYPE_PREREQS_HPP
 
 #include <cassert>
+#include <cstring>
 #include <stdint.h>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <functional>
+#include <iterator>
 #include <limits>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <thread>
+#include <vector>
 
 #include <QtCore>
 #include <QtDebug>
@@ -48,6 +58,185 @@ public:
     }
 };
 
+// threadCount <= 0 means one thread per core
+inline int resolveThreadCount(int threadCount) {
+    return threadCount > 0 ? threadCount : std::max(1, QThread::idealThreadCount());
+}
+
+// calls f(index, thread) for every index in [0, count) using at most threadCount threads.
+// thread is in [0, min(threadCount, count)) and can be used to address per thread state.
+template<typename F>
+void parallelFor(int count, int threadCount, F&& f) {
+    threadCount = std::min(resolveThreadCount(threadCount), count);
+
+    if (threadCount <= 1) {
+        for (int i = 0; i < count; i += 1) { f(i, 0); }
+        return;
+    }
+
+    std::atomic<int> next(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; t += 1) {
+        threads.emplace_back([&next, &f, count, t]() {
+            for (int i = next.fetch_add(1); i < count; i = next.fetch_add(1)) { f(i, t); }
+        });
+    }
+    for (auto& t : threads) { t.join(); }
+}
+
+// column[first + i] = old column[order[i]], e.g. to apply a sort order to every column of a table
+template<typename T>
+void permute(T* column, const QVector<s64>& order, s64 first) {
+    QVector<T> sorted;
+    sorted.reserve(order.size());
+    foreach (auto i, order) { sorted.append(column[i]); }
+    std::copy(sorted.begin(), sorted.end(), column + first);
+}
+
+// queue between the stages of a pipeline. push() waits while the queue holds capacity bytes or more, so that a fast
+// producer can not run away from a slow consumer, and pop() waits while it is empty. after close() push() drops the
+// element and returns false, and pop() returns false once the queue is empty. either side may close the queue: the
+// producer when it is done, the consumer to stop the producer early.
+template<typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(s64 capacity) : _capacity(capacity) { assert(capacity > 0); }
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    bool push(T t, s64 size) {
+        QMutexLocker lock(&_mutex);
+        while (_size >= _capacity && _closed == false) { _notFull.wait(&_mutex); }
+        if (_closed) { return false; }
+        _entries.enqueue(qMakePair(std::move(t), size));
+        _size += size;
+        _notEmpty.wakeOne();
+        return true;
+    }
+
+    bool pop(T* t) {
+        QMutexLocker lock(&_mutex);
+        while (_entries.isEmpty() && _closed == false) { _notEmpty.wait(&_mutex); }
+        if (_entries.isEmpty()) { return false; }
+        auto e = _entries.dequeue();
+        *t     = std::move(e.first);
+        _size -= e.second;
+        _notFull.wakeOne();
+        return true;
+    }
+
+    void close() {
+        QMutexLocker lock(&_mutex);
+        _closed = true;
+        _notFull .wakeAll();
+        _notEmpty.wakeAll();
+    }
+
+private:
+    QMutex                _mutex;
+    QWaitCondition        _notFull;
+    QWaitCondition        _notEmpty;
+    QQueue<QPair<T, s64>> _entries;
+    s64                   _size   = 0; // bytes
+    s64                   _capacity;
+    bool                  _closed = false;
+};
+
+// append-only list that stores its elements in chunks. chunks grow geometrically up to maxChunkSize elements, so
+// appending allocates once per chunk and never moves elements. += on an rvalue takes over the other list's chunks.
+// all memory is released at once on destruction. note: foreach copies the list, use range-based for.
+template<typename T, int maxChunkSize = 4096>
+class ChunkedList {
+    struct Chunk {
+        Chunk(int capacity) : elements(new T[capacity]), capacity(capacity) {}
+        std::unique_ptr<T[]> elements;
+        int                  size = 0;
+        int                  capacity;
+    };
+
+public:
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = T;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = const T*;
+        using reference         = const T&;
+
+        const_iterator() {}
+        const_iterator(const ChunkedList* l, int chunk, int i) : _l(l), _chunk(chunk), _i(i) {}
+        const T&        operator* () const                        { return _l->_chunks[_chunk]->elements[_i]; }
+        const T*        operator->() const                        { return &**this; }
+        const_iterator& operator++() {
+            _i += 1;
+            if (_i == _l->_chunks[_chunk]->size) { _chunk += 1; _i = 0; }
+            return *this;
+        }
+        const_iterator  operator++(int)                           { auto r = *this; ++*this; return r; }
+        bool            operator==(const const_iterator& o) const { return _chunk == o._chunk && _i == o._i; }
+        bool            operator!=(const const_iterator& o) const { return (*this == o) == false; }
+    private:
+        const ChunkedList* _l     = nullptr;
+        int                _chunk = 0;
+        int                _i     = 0;
+    };
+
+    using value_type = T;
+
+    ChunkedList() {}
+    ChunkedList(const ChunkedList& o) { *this = o; }
+    ChunkedList(ChunkedList&& o) : _chunks(std::move(o._chunks)), _size(o._size) { o._size = 0; }
+
+    ChunkedList& operator=(const ChunkedList& o) {
+        if (this == &o) { return *this; }
+        clear();
+        for (const auto& c : o._chunks) {
+            _chunks.emplace_back(new Chunk(c->size));
+            std::copy(c->elements.get(), c->elements.get() + c->size, _chunks.back()->elements.get());
+            _chunks.back()->size = c->size;
+        }
+        _size = o._size;
+        return *this;
+    }
+    ChunkedList& operator=(ChunkedList&& o) {
+        _chunks = std::move(o._chunks);
+        _size   = o._size;
+        o._size = 0;
+        return *this;
+    }
+
+    void append(const T& t) {
+        if (_chunks.empty() || _chunks.back()->size == _chunks.back()->capacity) {
+            _chunks.emplace_back(new Chunk(_chunks.empty() ? 16 : std::min(2 * _chunks.back()->capacity, maxChunkSize)));
+        }
+        auto& c = *_chunks.back();
+        c.elements[c.size] = t;
+        c.size += 1;
+        _size  += 1;
+    }
+
+    ChunkedList& operator+=(ChunkedList&& o) {
+        if (o._size == 0) { return *this; }
+        for (auto& c : o._chunks) { _chunks.push_back(std::move(c)); }
+        _size += o._size;
+        o.clear();
+        return *this;
+    }
+
+    void clear() { _chunks.clear(); _size = 0; }
+
+    s64  size()       const { return _size;                }
+    bool isEmpty()    const { return _size == 0;           }
+    int  chunkCount() const { return (int) _chunks.size(); } // allocations
+
+    const_iterator begin() const { return const_iterator(this, 0, 0);                    }
+    const_iterator end()   const { return const_iterator(this, (int) _chunks.size(), 0); }
+
+private:
+    std::vector<std::unique_ptr<Chunk>> _chunks; // none of them is empty
+    s64                                 _size = 0;
+};
+
 // QTextStream always buffers, which is bad for debug output
 extern AutoFlushingQTextStream qerr;
 extern AutoFlushingQTextStream qout;
@@ -1,13 +1,105 @@
 #include "rawtrace.hpp"
 
+#include "diagnostics.hpp"
 #include "trace.hpp"
 
+#include <fcntl.h>
+#include <time.h>
+
 using SentMessage     = RawTrace::SentMessage;
 using ReceivedMessage = RawTrace::ReceivedMessage;
+using Filter          = RawTrace::Filter;
+
+using SentMessageList     = RawTrace::SentMessageList;
+using ReceivedMessageList = RawTrace::ReceivedMessageList;
+
+using Statistics = RawTrace::Statistics;
+
+using MessageKey    = RawTrace::MessageKey;
+using SenderMatches = RawTrace::SenderMatches;
+
+// adds the wall and cpu time from construction to destruction to *t
+class ScopedTimer {
+public:
+    ScopedTimer(Statistics::Time* t, clockid_t cpuClock = CLOCK_PROCESS_CPUTIME_ID) : _t(t), _cpuClock(cpuClock), _cpuBegin(cpuSeconds(cpuClock)) {
+        _wall.start();
+    }
+    ~ScopedTimer() {
+        _t->wallSeconds += _wall.nsecsElapsed() * 1e-9;
+        _t->cpuSeconds  += cpuSeconds(_cpuClock) - _cpuBegin;
+    }
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    Statistics::Time* _t;
+    clockid_t         _cpuClock;
+    f64               _cpuBegin;
+    QElapsedTimer     _wall;
+
+    static f64 cpuSeconds(clockid_t c) {
+        timespec ts;
+        clock_gettime(c, &ts);
+        return ts.tv_sec + ts.tv_nsec * 1e-9;
+    }
+};
+
+// the counters of one reader, see EventUserData
+static void addReadStatistics(Statistics* to, const Statistics& from) {
+    to->sends     += from.sends;
+    to->receives  += from.receives;
+    to->isends    += from.isends;
+    to->irecvs    += from.irecvs;
+    to->enters    += from.enters;
+    to->leaves    += from.leaves;
+    to->bytesRead += from.bytesRead;
+
+    QMapIterator<process_t, Statistics::Time> i(from.processes);
+    while (i.hasNext()) {
+        i.next();
+        to->processes[i.key()].wallSeconds += i.value().wallSeconds;
+        to->processes[i.key()].cpuSeconds  += i.value().cpuSeconds;
+    }
+}
+
+static QJsonObject toJson(const Statistics::Time& t) {
+    return QJsonObject{{"wallSeconds", t.wallSeconds}, {"cpuSeconds", t.cpuSeconds}};
+}
+
+QByteArray RawTrace::Statistics::toJson() const {
+    QJsonObject ps;
+    QMapIterator<process_t, Time> i(processes);
+    while (i.hasNext()) {
+        i.next();
+        ps[QString::number(i.key())] = ::toJson(i.value());
+    }
+
+    QJsonObject o{
+        {"definitions",       ::toJson(definitions)},
+        {"events",            ::toJson(events)},
+        {"matching",          ::toJson(matching)},
+        {"processes",         ps},
+        {"sends",             (qint64) sends},
+        {"receives",          (qint64) receives},
+        {"isends",            (qint64) isends},
+        {"irecvs",            (qint64) irecvs},
+        {"enters",            (qint64) enters},
+        {"leaves",            (qint64) leaves},
+        {"bytesRead",         (qint64) bytesRead},
+        {"allocations",       (qint64) allocations},
+        {"matchedMessages",   (qint64) matchedMessages},
+        {"missingReceives",   (qint64) missingReceives},
+        {"unmatchedReceives", (qint64) unmatchedReceives},
+    };
+
+    return QJsonDocument(o).toJson();
+}
 
 // otf specifics ////////////////////////////////////////////////////////////
 
 #include <otf.h>
+#include <otf2/OTF2_Pthread_Locks.h>
+#include <zlib.h>
 
 struct Otf {
     enum class Which { Unknown, Otf1, Otf2 } which;
@@ -18,6 +110,7 @@ struct Otf {
 
     OTF2_GlobalDefReaderCallbacks *hd2;
     OTF2_GlobalEvtReaderCallbacks *he2;
+    OTF2_EvtReaderCallbacks *hle2;
     OTF2_Reader *r2;
 };
 
@@ -29,6 +122,7 @@ static int handleDefProcess(void* userData, process_t id, const char* name, proc
 static int handleSendMessage(void* userData, timestamp_t time, process_t sender, process_t receiver, processgroup_t group, messagetag_t tag, messagelength_t length);
 static int handleReceiveMessage(void* userData, timestamp_t time, process_t receiver, process_t sender, processgroup_t group, messagetag_t tag, messagelength_t length);
 static void handleEnterOrLeave(void* userData, timestamp_t time);
+static bool cancelled(void* userData);
 
 static int handleOtfDefProcess(void* userData, uint32_t stream, uint32_t id, const char* name, uint32_t parent);
 static int handleOtfSendMessage(void* userData, uint64_t time, uint32_t sender, uint32_t receiver, uint32_t group, uint32_t tag, uint32_t length, uint32_t source, OTF_KeyValueList* list);
@@ -40,6 +134,7 @@ static OTF2_CallbackCode handleOtf2DefProcess(void* userData, OTF2_LocationRef l
 static OTF2_CallbackCode handleOtf2DefString(void *userData, OTF2_StringRef self, const char *string);
 static OTF2_CallbackCode handleOtf2DefGroup(void *userData, OTF2_GroupRef group, OTF2_StringRef name, OTF2_GroupType groupType, OTF2_Paradigm paradigm, OTF2_GroupFlag groupFlags, uint32_t numberOfMembers, const uint64_t *members);
 static OTF2_CallbackCode handleOtf2DefCommunicator(void *userData, OTF2_CommRef com, OTF2_StringRef name, OTF2_GroupRef group, OTF2_CommRef parent);
+static OTF2_CallbackCode handleOtf2DefClockProperties(void *userData, uint64_t timerResolution, uint64_t globalOffset, uint64_t traceLength);
 static OTF2_CallbackCode handleOtf2MpiSend(OTF2_LocationRef sender, OTF2_TimeStamp time, void* userData, OTF2_AttributeList* a, uint32_t receiver, OTF2_CommRef com, uint32_t tag, uint64_t length);
 static OTF2_CallbackCode handleOtf2MpiIsend(OTF2_LocationRef sender, OTF2_TimeStamp time, void *userData, OTF2_AttributeList *a, uint32_t receiver, OTF2_CommRef com, uint32_t tag, uint64_t length, uint64_t requestId);
 static OTF2_CallbackCode handleOtf2MpiIsendComplete(OTF2_LocationRef sender, OTF2_TimeStamp time, void *userData, OTF2_AttributeList *a, uint64_t requestId);
@@ -50,31 +145,251 @@ static OTF2_CallbackCode handleOtf2MpiRequestCancelled(OTF2_LocationRef location
 static OTF2_CallbackCode handleOtf2Enter(OTF2_LocationRef location, OTF2_TimeStamp time, void* userData, OTF2_AttributeList* a, OTF2_RegionRef region);
 static OTF2_CallbackCode handleOtf2Leave(OTF2_LocationRef location, OTF2_TimeStamp time, void* userData, OTF2_AttributeList* a, OTF2_RegionRef region);
 
+// local event reader callbacks only differ from the global ones by the additional event position
+static OTF2_CallbackCode handleOtf2LocalMpiSend(OTF2_LocationRef sender, OTF2_TimeStamp time, uint64_t position, void* userData, OTF2_AttributeList* a, uint32_t receiver, OTF2_CommRef com, uint32_t tag, uint64_t length);
+static OTF2_CallbackCode handleOtf2LocalMpiIsend(OTF2_LocationRef sender, OTF2_TimeStamp time, uint64_t position, void *userData, OTF2_AttributeList *a, uint32_t receiver, OTF2_CommRef com, uint32_t tag, uint64_t length, uint64_t requestId);
+static OTF2_CallbackCode handleOtf2LocalMpiIsendComplete(OTF2_LocationRef sender, OTF2_TimeStamp time, uint64_t position, void *userData, OTF2_AttributeList *a, uint64_t requestId);
+static OTF2_CallbackCode handleOtf2LocalMpiRecv(OTF2_LocationRef receiver, OTF2_TimeStamp time, uint64_t position, void* userData, OTF2_AttributeList* a, uint32_t sender, OTF2_CommRef com, uint32_t tag, uint64_t length);
+static OTF2_CallbackCode handleOtf2LocalMpiIrecv(OTF2_LocationRef receiver, OTF2_TimeStamp time, uint64_t position, void *userData, OTF2_AttributeList *a, uint32_t sender, OTF2_CommRef com, uint32_t tag, uint64_t length, uint64_t requestId);
+static OTF2_CallbackCode handleOtf2LocalMpiIrecvRequest(OTF2_LocationRef locationId, OTF2_TimeStamp time, uint64_t position, void *userData, OTF2_AttributeList *a, uint64_t requestId);
+static OTF2_CallbackCode handleOtf2LocalMpiRequestCancelled(OTF2_LocationRef locationId, OTF2_TimeStamp time, uint64_t position, void *userData, OTF2_AttributeList *a, uint64_t requestID);
+static OTF2_CallbackCode handleOtf2LocalEnter(OTF2_LocationRef location, OTF2_TimeStamp time, uint64_t position, void* userData, OTF2_AttributeList* a, OTF2_RegionRef region);
+static OTF2_CallbackCode handleOtf2LocalLeave(OTF2_LocationRef location, OTF2_TimeStamp time, uint64_t position, void* userData, OTF2_AttributeList* a, OTF2_RegionRef region);
+
 // RawTrace /////////////////////////////////////////////////////////////////
+// receives of one MessageKey in order. next is the first one not matched yet.
+struct ReceiveQueue {
+    QVector<ReceivedMessage> messages;
+    mutable int              next = 0;
+};
+
+// duration of a row of StreamingMatcher that has no receive yet
+static const timestamp_t unmatchedDuration = std::numeric_limits<timestamp_t>::min();
+
+// matches sends and receives while they are being read, see RawTrace::setStreamingMatching().
+// every sender's matches are kept in the order it sent them: send() reserves the next row of the sender's columns, and
+// the receive fills in the duration once it arrives. unmatched sends wait in their key's queue with just their row.
+// thread safe: keys are sharded, and every shard and every sender has its own lock. locks are taken shard, then sender.
+// the sends of one sender must come from one thread, which is the case as every process is read by one reader.
+class StreamingMatcher {
+public:
+    StreamingMatcher(const QHash<process_t, processindex_t>& processIndex) : _processIndex(processIndex), _senders(processIndex.size()) {}
+
+    // messages are matched by their ordinal, see RawTrace::Filter. without filter all ordinals are 0, which is plain fifo order.
+    void send(process_t sender, const SentMessage& s) {
+        auto k = MessageKey{sender, s.receiver, s.group, s.tag};
+        auto& shard = shardOf(k);
+        QMutexLocker lock(&shard.mutex);
+
+        const ReceivedMessage* r = nullptr;
+
+        auto it = shard.queues.find(k);
+        if (it != shard.queues.end() && it.value().receives.isEmpty() == false) {
+            auto& receives = it.value().receives;
+            while (receives.isEmpty() == false && receives.head().ordinal < s.ordinal) { receives.dequeue(); } // their sends were filtered
+
+            if (receives.isEmpty() == false && receives.head().ordinal == s.ordinal) { r = &receives.head(); }
+
+            // a later receive means the receive of this send was filtered. it stays missing, so it is not queued
+            s64 row = append(&shard, k, s, r);
+            if (r != nullptr) { receives.dequeue(); }
+            else if (receives.isEmpty()) { it.value().sends.enqueue(PendingSend{row, s.ordinal}); }
+
+            if (it.value().sends.isEmpty() && it.value().receives.isEmpty()) { shard.queues.erase(it); }
+        } else {
+            s64 row = append(&shard, k, s, nullptr);
+            shard.queues[k].sends.enqueue(PendingSend{row, s.ordinal});
+        }
+    }
+
+    void receive(process_t receiver, const ReceivedMessage& r) {
+        auto k = MessageKey{r.sender, receiver, r.group, r.tag};
+        auto& shard = shardOf(k);
+        QMutexLocker lock(&shard.mutex);
+
+        auto it = shard.queues.find(k);
+        if (it != shard.queues.end() && it.value().sends.isEmpty() == false) {
+            auto& sends = it.value().sends;
+            while (sends.isEmpty() == false && sends.head().ordinal < r.ordinal) { sends.dequeue(); } // their receives were filtered. they stay missing
+
+            if (sends.isEmpty() == false && sends.head().ordinal == r.ordinal) {
+                fill(&shard, k, sends.dequeue().row, r);
+            } else if (sends.isEmpty() == false) { // the send of this receive was filtered
+            } else {
+                it.value().receives.enqueue(r);
+            }
+
+            if (it.value().sends.isEmpty() && it.value().receives.isEmpty()) { shard.queues.erase(it); }
+        } else {
+            shard.queues[k].receives.enqueue(r);
+        }
+    }
+
+    // can run concurrently for different senders. O(sends of sender). copies the sender's matches so far, without the
+    // rows that still wait for their receive. take moves them out instead, after which no further messages of this
+    // sender may be matched. for the final toTrace() only
+    void collect(process_t sender, SenderMatches* m, bool take) {
+        auto& x = _senders[_processIndex[sender]];
+        QMutexLocker lock(&x.mutex);
+
+        if (take == false) { // the pending rows stay where send() put them, see PendingSend
+            m->time    .reserve(x.m.time.size());
+            m->duration.reserve(x.m.time.size());
+            m->receiver.reserve(x.m.time.size());
+            m->length  .reserve(x.m.time.size());
+            for (int i = 0; i < x.m.time.size(); i += 1) {
+                if (x.m.duration[i] == unmatchedDuration) { continue; }
+                m->time    .append(x.m.time    [i]);
+                m->duration.append(x.m.duration[i]);
+                m->receiver.append(x.m.receiver[i]);
+                m->length  .append(x.m.length  [i]);
+            }
+            m->missingReceives = x.m.missingReceives;
+            return;
+        }
+
+        // drop the rows of missing receives, in place
+        int n = 0;
+        for (int i = 0; i < x.m.time.size(); i += 1) {
+            if (x.m.duration[i] == unmatchedDuration) { continue; }
+            x.m.time    [n] = x.m.time    [i];
+            x.m.duration[n] = x.m.duration[i];
+            x.m.receiver[n] = x.m.receiver[i];
+            x.m.length  [n] = x.m.length  [i];
+            n += 1;
+        }
+        x.m.time    .resize(n);
+        x.m.duration.resize(n);
+        x.m.receiver.resize(n);
+        x.m.length  .resize(n);
+
+        *m = std::move(x.m);
+        x.m = SenderMatches();
+    }
+
+    void collectDiagnostics(Diagnostics* d) const {
+        for (const auto& shard : _shards) {
+            d->merge(shard.diagnostics);
+        }
+    }
+
+    s64 unmatchedReceiveCount() const {
+        s64 ret = 0;
+        for (const auto& shard : _shards) {
+            foreach (const auto& q, shard.queues) {
+                ret += q.receives.size();
+            }
+        }
+        return ret;
+    }
+
+private:
+    struct PendingSend {
+        s64 row;     // in the columns of the sender
+        s64 ordinal;
+    };
+
+    struct Queue { // at most one of both is non-empty at a time
+        QQueue<PendingSend>     sends;
+        QQueue<ReceivedMessage> receives;
+    };
+
+    struct Shard {
+        QMutex                   mutex;
+        QHash<MessageKey, Queue> queues;
+        Diagnostics              diagnostics;
+    };
+
+    struct Sender {
+        QMutex        mutex;
+        SenderMatches m; // rows in send order. missingReceives counts the rows that are unmatched so far
+    };
+
+    static const int shardCount = 64;
+    Shard _shards[shardCount];
+
+    const QHash<process_t, processindex_t>& _processIndex; // see RawTrace::processIndex()
+    std::vector<Sender>                     _senders;      // by process index
+
+    Shard& shardOf(const MessageKey& k) { return _shards[qHash(k) % shardCount]; }
+
+    // appends the row of send s, matched with r if that is set. returns its row
+    s64 append(Shard* shard, const MessageKey& k, const SentMessage& s, const ReceivedMessage* r) {
+        processindex_t receiverIndex = _processIndex.value(s.receiver, -1);
+        assert(r == nullptr || receiverIndex != -1); // it has been read, so it is defined
+
+        auto& x = _senders[_processIndex[k.sender]];
+        QMutexLocker lock(&x.mutex);
+
+        x.m.time    .append(s.time);
+        x.m.duration.append(r != nullptr ? r->time - s.time : unmatchedDuration);
+        x.m.receiver.append(receiverIndex);
+        x.m.length  .append(s.length);
+
+        if (r != nullptr) { diagnose(shard, k, s.time, s.length, *r); }
+        else              { x.m.missingReceives[k] += 1; }
+
+        return x.m.time.size() - 1;
+    }
+
+    // matches the pending row with r
+    void fill(Shard* shard, const MessageKey& k, s64 row, const ReceivedMessage& r) {
+        auto& x = _senders[_processIndex[k.sender]];
+        QMutexLocker lock(&x.mutex);
+
+        x.m.duration[(int) row] = r.time - x.m.time[(int) row];
+        diagnose(shard, k, x.m.time[(int) row], x.m.length[(int) row], r);
+
+        if (--x.m.missingReceives[k] == 0) { x.m.missingReceives.remove(k); }
+    }
+
+    static void diagnose(Shard* shard, const MessageKey& k, timestamp_t time, messagelength_t length, const ReceivedMessage& r) {
+        if (time > r.time) {
+            shard->diagnostics.add(Diagnostics::Category::SendAfterReceive, k.sender, k.receiver, time, r.time - time);
+        }
+        if (length > r.length) {
+            shard->diagnostics.add(Diagnostics::Category::ReceiveTooShort, k.sender, k.receiver, time, length - r.length);
+        }
+    }
+};
+
+RawTrace::RawTrace() : _diagnostics(new Diagnostics) {}
+
+RawTrace::~RawTrace() {}
+
 void RawTrace::setTraceFileName(const QString& f) {
     assert(_traceFileName      == QString());
     assert(_loadedDefinitions  == false);
-    assert(_loadedEvents       == QSet<process_t>());
 
     _traceFileName = f;
 }
 
+static QList<process_t> orderProcesses(const QSet<process_t>& processes, const QMap<process_t, process_t>& parents);
+
 struct DefinitionUserData {
     QSet<process_t>*              processes;
     QMap<process_t, QString>*     processNames;
     QMap<process_t, process_t>*   processParents;
     QMap<OTF2_StringRef, QString> strings;
 
-    QMap<OTF2_CommRef, OTF2_GroupRef> communicatorToGroup;
-    QMap<OTF2_GroupRef, QMap<uint32_t/*local rank*/, uint64_t /*rank in comm world*/>> localRankToGlobalRank;
+    QHash<OTF2_CommRef, OTF2_GroupRef> communicatorToGroup;
+    QHash<OTF2_GroupRef, QVector<uint64_t /*rank in comm world*/>> localRankToGlobalRank; // indexed by local rank
     OTF2_GroupRef locationGroup;
     bool hasMpiLocationGroup = false;
+
+    timestamp_t clockBeginTime = std::numeric_limits<timestamp_t>::max(); // otf2 clock properties
+    timestamp_t clockEndTime   = std::numeric_limits<timestamp_t>::min();
 };
 
+// _localRankToLocation is indexed by communicator ref. otf2 numbers definitions densely from 0, so real refs stay far below
+static const OTF2_CommRef otf2MaxCommunicatorRef = 1 << 20;
+
 void RawTrace::loadDefinitions() {
     assert(_traceFileName != QString());
     if (_loadedDefinitions == true) { return; }
 
+    ScopedTimer timer(&_statistics.definitions);
+
     Otf otf;
     Otf_init(&otf);
     Otf_open(_traceFileName, &otf);
@@ -90,16 +405,22 @@ void RawTrace::loadDefinitions() {
 
         OTF_Reader_readDefinitions(otf.r, otf.h);
     } else {
-        OTF2_GlobalDefReaderCallbacks_SetLocationCallback(otf.hd2, &handleOtf2DefProcess     );
-        OTF2_GlobalDefReaderCallbacks_SetStringCallback  (otf.hd2, &handleOtf2DefString      );
-        OTF2_GlobalDefReaderCallbacks_SetGroupCallback   (otf.hd2, &handleOtf2DefGroup       );
-        OTF2_GlobalDefReaderCallbacks_SetCommCallback    (otf.hd2, &handleOtf2DefCommunicator);
+        _otf2 = true;
+
+        OTF2_GlobalDefReaderCallbacks_SetLocationCallback       (otf.hd2, &handleOtf2DefProcess        );
+        OTF2_GlobalDefReaderCallbacks_SetStringCallback         (otf.hd2, &handleOtf2DefString         );
+        OTF2_GlobalDefReaderCallbacks_SetGroupCallback          (otf.hd2, &handleOtf2DefGroup          );
+        OTF2_GlobalDefReaderCallbacks_SetCommCallback           (otf.hd2, &handleOtf2DefCommunicator   );
+        OTF2_GlobalDefReaderCallbacks_SetClockPropertiesCallback(otf.hd2, &handleOtf2DefClockProperties);
 
         OTF2_Reader_RegisterGlobalDefCallbacks(otf.r2, OTF2_Reader_GetGlobalDefReader(otf.r2), otf.hd2, &u);
 
         uint64_t dummyEventsRead;
         OTF2_Reader_ReadAllGlobalDefinitions(otf.r2, OTF2_Reader_GetGlobalDefReader(otf.r2), &dummyEventsRead);
 
+        _clockBeginTime = u.clockBeginTime;
+        _clockEndTime   = u.clockEndTime;
+
         //set process names to include the group id
         foreach (process_t p, _processes) {
             unsigned long int stringId;
@@ -109,30 +430,42 @@ void RawTrace::loadDefinitions() {
         }
 
         // generate _localRankToLocation from from communicatorToGroup, localRankToGlobalRank, globalRankToLocation
-        // this might take too long -> change it maybe
+        // one pass over the members of every group. communicators of the same group share its array.
         if (u.hasMpiLocationGroup == true) {
 
-            QMapIterator<OTF2_CommRef, OTF2_GroupRef> i(u.communicatorToGroup);
+            const auto globalRankToLocation = u.localRankToGlobalRank.value(u.locationGroup); // implicitly shared
+
+            QHash<OTF2_GroupRef, QVector<OTF2_LocationRef>> groupLocations;
+
+            QHashIterator<OTF2_CommRef, OTF2_GroupRef> i(u.communicatorToGroup);
             while (i.hasNext()) {
                 i.next();
                 auto com   = i.key();
                 auto group = i.value();
 
+                if (com >= otf2MaxCommunicatorRef) { // e.g. OTF2_UNDEFINED_COMM, which would make the array 4 G entries long
+                    qerr << "warning: ignoring communicator " << com << ", refs of " << otf2MaxCommunicatorRef << " and above are not supported.\n";
+                    continue;
+                }
+
                 assert(u.localRankToGlobalRank.contains(group));
-                QMapIterator<uint32_t, uint64_t> j(u.localRankToGlobalRank[group]);
-                while (j.hasNext()) {
-                    j.next();
-
-                    auto localRank  = j.key();
-                    auto globalRank = j.value();
-
-                    if (u.localRankToGlobalRank[u.locationGroup].contains(globalRank)) {
-                        auto location = u.localRankToGlobalRank[u.locationGroup][globalRank];
-                        _localRankToLocation[QPair<OTF2_CommRef, uint32_t>(com, localRank)] = location;
-                    } else {
-                        // this is not an mpi rank. no mapping added. since threads do not send messages from their ids (hopefully)
+
+                if (groupLocations.contains(group) == false) {
+                    const auto globalRanks = u.localRankToGlobalRank.value(group);
+                    QVector<OTF2_LocationRef> locations(globalRanks.size(), OTF2_UNDEFINED_LOCATION);
+                    for (int localRank = 0; localRank < globalRanks.size(); localRank += 1) {
+                        auto globalRank = globalRanks[localRank];
+                        if (globalRank < (uint64_t) globalRankToLocation.size()) {
+                            locations[localRank] = globalRankToLocation[(int) globalRank];
+                        } else {
+                            // this is not an mpi rank. no mapping added. since threads do not send messages from their ids (hopefully)
+                        }
                     }
+                    groupLocations[group] = locations;
                 }
+
+                if ((s64) com >= _localRankToLocation.size()) { _localRankToLocation.resize((int) com + 1); }
+                _localRankToLocation[(int) com] = groupLocations[group]; // shared, not copied
             }
 
             // make sure the child/parent ids gathered exist. This is not a given for our hackish OTF2 implementation.
@@ -147,123 +480,1103 @@ void RawTrace::loadDefinitions() {
             // * this trace has no mpi calls
             // * don't create any mapping because the code would explode with 'u.locationGroup' being undefined
             // * assert(u.communicatorToGroup.isEmpty()); // doesn't work since there is something are communicators in traces without mpi. they refer to openmp groups e.g. (i don't know why. just reporting)
-            // * this should be fine since _localRankToLocation is then empty and before every mapping there is an assertion for containment.
+            // * this should be fine since _localRankToLocation is then empty and every mapping is asserted to exist.
         }
     }
 
     Otf_finalize(&otf);
 
+    _orderedProcesses = orderProcesses(_processes, _processParents);
+
+    _processIndex.reserve(_orderedProcesses.size());
+    for (int i = 0; i < _orderedProcesses.size(); i += 1) {
+        _processIndex[_orderedProcesses[i]] = i;
+    }
+
+    _sentMessages    .resize(_orderedProcesses.size());
+    _receivedMessages.resize(_orderedProcesses.size());
+    _loadedEvents    .fill(false, _orderedProcesses.size());
+
     _loadedDefinitions = true;
 }
 
-void RawTrace::loadEvents() {
-    assert(_traceFileName != QString());
+struct EventUserData {
+    EventUserData(const QVector<QVector<OTF2_LocationRef>>& localRankToLocation, const Filter* filter, StreamingMatcher* matcher) : localRankToLocation(localRankToLocation), filter(filter), matcher(matcher) {}
 
-    loadDefinitions();
+    const QVector<QVector<OTF2_LocationRef>>& localRankToLocation; // [communicator][local rank]. http://blog.automaton2000.com/2015/05/how-to-map-local-mpi-ranks-to-otf2-locations.html
 
-    foreach(auto p, _processes) {
-        loadEvents(p);
+    // OTF2_UNDEFINED_LOCATION if unmapped
+    OTF2_LocationRef location(OTF2_CommRef com, uint32_t localRank) const {
+        if (com >= (OTF2_CommRef) localRankToLocation.size()) { return OTF2_UNDEFINED_LOCATION; }
+        const auto& locations = localRankToLocation.at((int) com);
+        return localRank < (uint32_t) locations.size() ? locations.at((int) localRank) : OTF2_UNDEFINED_LOCATION;
     }
-}
 
-struct EventUserData {
-    const QMap<QPair<OTF2_CommRef, uint32_t /*local rank*/>, OTF2_LocationRef>& localRankToLocation; // http://blog.automaton2000.com/2015/05/how-to-map-local-mpi-ranks-to-otf2-locations.html
+    // owned by whoever reads the events (e.g. one loader thread) and merged into RawTrace afterwards
+    QMap<process_t, SentMessageList>        sentMessages;
+    QMap<process_t, ReceivedMessageList>    receivedMessages;
+    SentMessageList*     lastSentMessages     = nullptr; // resolved once per run of records of the same process, not per record
+    process_t            lastSender           = 0;
+    ReceivedMessageList* lastReceivedMessages = nullptr;
+    process_t            lastReceiver         = 0;
+    timestamp_t beginTime = std::numeric_limits<timestamp_t>::max();
+    timestamp_t endTime   = std::numeric_limits<timestamp_t>::min();
+
+    Statistics statistics; // record counts, bytes and process times of this reader
+
+    // their otf stream broke after some of their records had been handed on. RawTrace::loadEvents() drops what was read
+    // of them and does not mark them as loaded
+    QSet<process_t> failedProcesses;
+
+    bool                     skipEnterLeave   = false;   // see RawTrace::setSkipEnterLeave()
+    bool                     nativeOtfParsing = false;   // see RawTrace::setNativeOtfParsing()
+    const std::atomic<bool>* cancel           = nullptr; // see RawTrace::setCancelFlag()
+
+    const Filter*          filter;
+    QHash<MessageKey, s64> sendOrdinals;    // only counted if filter->needsOrdinals()
+    QHash<MessageKey, s64> receiveOrdinals;
+
+    // if set, messages are handed to the matcher instead of being stored above
+    StreamingMatcher*       matcher;
+
+    // otf2 non-blocking communication: https://qvampir.zih.tu-dresden.de/Score-P-On/wiki/OTF2%20%3A%20How%20to%20Map%20Non-Blocking%20Send/Receive%20to%20normal%20Send/Receive
+    // for correct matching, sends (receives) have to be handed on in the order they were issued, but an isend (irecv)
+    // is only complete later. so per location they are queued in issue order and released from the front as soon as
+    // the front is complete. requests are found by id. all operations are O(1) amortized.
+    template<typename M>
+    class RequestQueue {
+    public:
+        bool isEmpty() const { return _head == _entries.size(); }
+
+        void issue(const M& m) { // complete right away, e.g. a blocking send
+            _entries.append(Entry{State::Complete, m});
+        }
+        void issueRequest(uint64_t requestId, const M& m = M{}) { // m may also be set by complete()
+            assert(_requests.contains(requestId) == false);
+            _requests.insert(requestId, _base + _entries.size());
+            _entries.append(Entry{State::Pending, m});
+        }
+        bool hasRequest(uint64_t requestId) const { return _requests.contains(requestId); }
+        void complete(uint64_t requestId, const M* m = nullptr) { entry(requestId)->state = State::Complete; if (m != nullptr) { entry(requestId)->message = *m; } _requests.remove(requestId); }
+        void cancel  (uint64_t requestId)                       { entry(requestId)->state = State::Cancelled;                                                      _requests.remove(requestId); }
+
+        // calls f for every complete message at the front until the first pending request. stops if f fails
+        template<typename F>
+        bool release(F&& f) {
+            bool ok = true;
+            for (; ok && _head < _entries.size() && _entries[_head].state != State::Pending; _head += 1) {
+                if (_entries[_head].state == State::Complete) { ok = f(_entries[_head].message); }
+            }
+            compact();
+            return ok;
+        }
 
-    QMap<process_t, QList<SentMessage>>*     sentMessages;
-    QMap<process_t, QList<ReceivedMessage>>* receivedMessages;
-    timestamp_t* beginTime;
-    timestamp_t* endTime;
+    private:
+        enum class State { Pending, Complete, Cancelled };
+        struct Entry {
+            State state;
+            M     message;
+        };
+
+        QVector<Entry>       _entries; // issue order. the ones before _head have been released
+        int                  _head = 0;
+        s64                  _base = 0; // sequence number of _entries[0]
+        QHash<uint64_t, s64> _requests; // pending request id -> sequence number
+
+        Entry* entry(uint64_t requestId) {
+            assert(_requests.contains(requestId));
+            return &_entries[(int) (_requests[requestId] - _base)];
+        }
 
-    struct IreceiveRequest { // https://qvampir.zih.tu-dresden.de/Score-P-On/wiki/OTF2%20%3A%20How%20to%20Map%20Non-Blocking%20Send/Receive%20to%20normal%20Send/Receive
-        uint64_t requestId;
-        QQueue<ReceivedMessage> blockedReceives;
+        // drops the released entries once they are at least half of _entries. so memory stays bounded by the unreleased
+        // ones even if a location always has a pending request at the back. every entry is moved at most once per
+        // halving, so this is O(1) amortized
+        void compact() {
+            if (_head == 0 || _head * 2 < _entries.size()) { return; }
+            _entries.erase(_entries.begin(), _entries.begin() + _head);
+            _base += _head;
+            _head  = 0;
+        }
     };
 
-    struct Isend {
-        OTF2_TimeStamp     time;
-        OTF2_LocationRef   sender;
-        OTF2_LocationRef   receiver;
-        OTF2_CommRef       com;
-        uint64_t           length;
-        uint32_t           tag;
-        uint64_t           requestId;
-        QQueue<SentMessage> blockedSends;
+    QHash<OTF2_LocationRef, RequestQueue<ReceivedMessage>> receiveRequests;
+    QHash<OTF2_LocationRef, RequestQueue<SentMessage>>     sendRequests;
+};
+
+static void setOtfEventHandlers(Otf* otf, EventUserData* u) {
+    OTF_HandlerArray_setHandler        (otf->h, (OTF_FunctionPointer*) handleOtfSendMessage   , OTF_SEND_RECORD   );
+    OTF_HandlerArray_setFirstHandlerArg(otf->h, u                                             , OTF_SEND_RECORD   );
+    OTF_HandlerArray_setHandler        (otf->h, (OTF_FunctionPointer*) handleOtfReceiveMessage, OTF_RECEIVE_RECORD);
+    OTF_HandlerArray_setFirstHandlerArg(otf->h, u                                             , OTF_RECEIVE_RECORD);
+    if (u->skipEnterLeave) { return; }
+    OTF_HandlerArray_setHandler        (otf->h, (OTF_FunctionPointer*) handleOtfEnter         , OTF_ENTER_RECORD  );
+    OTF_HandlerArray_setFirstHandlerArg(otf->h, u                                             , OTF_ENTER_RECORD  );
+    OTF_HandlerArray_setHandler        (otf->h, (OTF_FunctionPointer*) handleOtfLeave         , OTF_LEAVE_RECORD  );
+    OTF_HandlerArray_setFirstHandlerArg(otf->h, u                                             , OTF_LEAVE_RECORD  );
+}
+
+// without enter/leave handlers: the time range of the records of the enabled streams. call after reading.
+static void readOtfTimeRange(Otf* otf, EventUserData* u) {
+    if (u->skipEnterLeave == false) { return; }
+    uint64_t minimum, current, maximum;
+    if (OTF_Reader_eventTimeProgress(otf->r, &minimum, &current, &maximum) == 1) {
+        u->beginTime = std::min(u->beginTime, (timestamp_t) minimum);
+        u->endTime   = std::max(u->endTime  , (timestamp_t) maximum);
+    }
+}
+
+static void readOtfBytes(Otf* otf, EventUserData* u) {
+    uint64_t minimum, current, maximum;
+    if (OTF_Reader_eventBytesProgress(otf->r, &minimum, &current, &maximum) == 1) {
+        u->statistics.bytesRead += (s64) (current - minimum);
+    }
+}
+
+// otf2 archives keep the events of location l in <archive>/<l>.evt
+static s64 otf2EventFileSize(const QString& traceFileName, process_t location) {
+    QFileInfo f(traceFileName);
+    return QFileInfo(f.absoluteDir().filePath(f.completeBaseName() + "/" + QString::number(location) + ".evt")).size();
+}
+
+// native otf parsing ///////////////////////////////////////////////////////
+//
+// otf streams are text, usually zlib compressed. a line with a hex time stamp or with *<hex process> sets the time
+// or the process of the records that follow. every other line is a record that starts with its keyword. the records
+// read here look like this in the short format, fields in [] are optional:
+//   E<function>[X<source>]                               enter
+//   L[<function>][X<source>]                             leave
+//   S<receiver>L<length>T<tag>C<communicator>[X<source>] send
+//   R<sender>L<length>T<tag>C<communicator>[X<source>]   receive
+// numbers are lower case hex, so the upper case field letters delimit them. all other records are skipped.
+// the records go to the same handlers as with the otf library, but without its callback dispatch per record.
+
+// keywords of the short format records found in otf event streams. a stream that starts with any other record, e.g.
+// because it is written in the long format, is left to the otf library.
+static const QSet<QByteArray> otfShortKeywords = {"E", "L", "S", "R", "CNT", "COP", "COPB", "COPE", "PB", "PE", "K", "F", "TE", "TOF", "TCNT", "TCOC", "TS"};
+
+static const int otfBlockSize    = 4 << 20;  // bytes read from a stream file at a time
+static const int otfChunkSize    = 1 << 20;  // decompressed bytes parsed at a time
+static const s64 otfLaneCapacity = 16 << 20; // bytes queued per lane and stage, see readOtfStreamsPipelined()
+
+// value of a hex digit, -1 for anything else. otf writes lower case digits only
+static const std::array<s8, 256> otfHexDigits = [] {
+    std::array<s8, 256> a;
+    a.fill(-1);
+    for (int i = 0; i < 10; i += 1) { a['0' + i] = (s8) i;        }
+    for (int i = 0; i <  6; i += 1) { a['a' + i] = (s8) (10 + i); }
+    return a;
+}();
+
+// lets the kernel read the whole file ahead, as it is read sequentially. posix only
+static void adviseSequentialRead(QFile* f) {
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(f->handle(), 0, 0, POSIX_FADV_SEQUENTIAL);
+    posix_fadvise(f->handle(), 0, 0, POSIX_FADV_WILLNEED);
+#else
+    (void) f;
+#endif
+}
+
+// inflates one compressed otf stream. otf flushes its deflate streams but does not always finish them, so the input
+// may end without Z_STREAM_END.
+class OtfInflater {
+public:
+    OtfInflater() {
+        memset(&_z, 0, sizeof(_z));
+        _ok = inflateInit(&_z) == Z_OK;
+    }
+    ~OtfInflater() {
+        if (_ok) { inflateEnd(&_z); }
+    }
+    OtfInflater(const OtfInflater&) = delete;
+    OtfInflater& operator=(const OtfInflater&) = delete;
+
+    // for the next stream
+    void reset() {
+        if (_ok) { inflateReset(&_z); }
+    }
+
+    // inflates the next size bytes of the stream and calls f(data, size) with the output, at most otfChunkSize bytes
+    // at a time. stops early if f returns false. returns false if the input is corrupt
+    template<typename F>
+    bool feed(const char* in, int size, F&& f) {
+        if (_ok == false) { return false; }
+
+        _z.next_in  = (Bytef*) in;
+        _z.avail_in = (uInt) size;
+        do {
+            _z.next_out  = (Bytef*) _out.data();
+            _z.avail_out = (uInt) _out.size();
+
+            int r = inflate(&_z, Z_NO_FLUSH);
+            if (r != Z_OK && r != Z_STREAM_END && r != Z_BUF_ERROR) { return false; }
+
+            int n = _out.size() - (int) _z.avail_out;
+            if (n > 0 && f(_out.constData(), n) == false) { return true; }
+
+            if      (r == Z_STREAM_END) { inflateReset(&_z); } // another stream may follow
+            else if (n == 0)            { break;             } // needs more input
+        } while (_z.avail_in > 0 || _z.avail_out == 0);
+
+        return true;
+    }
+
+private:
+    z_stream   _z;
+    bool       _ok;
+    QByteArray _out = QByteArray(otfChunkSize, Qt::Uninitialized);
+};
+
+// otf keeps the events of stream s in <trace>.<hex s>.events, or in .events.z if they are compressed
+static QString otfEventFileName(const QString& traceFileName, uint32_t stream) {
+    QString stub = traceFileName.endsWith(".otf") ? traceFileName.left(traceFileName.size() - 4) : traceFileName;
+    QString name = QString("%1.%2.events").arg(stub).arg(stream, 0, 16);
+    return QFileInfo(name + ".z").exists() ? name + ".z" : name;
+}
+
+// whether all records in [b, e) are short format records, see otfShortKeywords
+static bool isShortOtfFormat(const char* b, const char* e) {
+    for (const char* line = b; line < e;) {
+        const char* lineEnd = (const char*) memchr(line, '\n', e - line);
+        if (lineEnd == nullptr) { lineEnd = e; }
+
+        if (line < lineEnd && *line != '*' && otfHexDigits[(u8) *line] < 0) {
+            const char* k = line;
+            while (k < lineEnd && *k >= 'A' && *k <= 'Z') { k += 1; }
+            if (otfShortKeywords.contains(QByteArray::fromRawData(line, (int) (k - line))) == false) { return false; }
+        }
+
+        line = lineEnd + 1;
+    }
+    return true;
+}
+
+// parses the hex number at *i and moves *i behind it. false if there is none, or if it does not fit into 64 bits
+static inline bool parseOtfHex(const char** i, const char* end, u64* v) {
+    const char* b = *i;
+    u64 r = 0;
+    bool fits = true;
+    for (; *i < end; *i += 1) {
+        s8 d = otfHexDigits[(u8) **i];
+        if (d < 0) { break; }
+        fits = fits && (r >> 60) == 0;
+        r = (r << 4) | (u64) d;
+    }
+    *v = r;
+    return *i != b && fits;
+}
+
+// parses <letter><hex> at *i, e.g. L5be00
+static inline bool parseOtfField(const char** i, const char* end, char letter, u64* v) {
+    if (*i == end || **i != letter) { return false; }
+    *i += 1;
+    return parseOtfHex(i, end, v);
+}
+
+// parses the optional X<source> at the end of a record
+static inline bool parseOtfSourceAndEnd(const char** i, const char* end, u64* source) {
+    *source = 0;
+    if (*i != end && parseOtfField(i, end, 'X', source) == false) { return false; }
+    return *i == end;
+}
+
+struct OtfParserState {
+    const QSet<process_t>* processes; // the records of other processes are skipped
+
+    timestamp_t time       = 0;
+    process_t   process    = 0;
+    bool        hasProcess = false;
+    bool        enabled    = false; // process is one of processes
+    bool        handedOn   = false; // a record went to the handlers
+
+    // of all records, like OTF_Reader_eventTimeProgress()
+    timestamp_t firstTime = std::numeric_limits<timestamp_t>::max();
+    timestamp_t lastTime  = std::numeric_limits<timestamp_t>::min();
+};
+
+enum class OtfLineResult { Ok, Malformed, Aborted };
+
+// parses the line [b, e), without its '\n'
+static OtfLineResult parseOtfLine(const char* b, const char* e, OtfParserState* s, EventUserData* u) {
+    if (b == e) { return OtfLineResult::Ok; }
+
+    const char* i = b + 1;
+    u64 a, length, tag, group, source;
+
+    // records that are read start with a single letter keyword followed by a number (or nothing for a leave)
+    bool number = i != e && otfHexDigits[(u8) *i] >= 0;
+
+    switch (*b) {
+    case '*':
+        if (parseOtfHex(&i, e, &a) == false || i != e) { return OtfLineResult::Malformed; }
+        if (s->hasProcess == false || (process_t) a != s->process) {
+            s->process    = (process_t) a;
+            s->hasProcess = true;
+            s->enabled    = s->processes->contains(s->process);
+        }
+        return OtfLineResult::Ok;
+
+    case 'E':
+        if (number == false || s->enabled == false || u->skipEnterLeave) { return OtfLineResult::Ok; }
+        if (parseOtfHex(&i, e, &a) == false || parseOtfSourceAndEnd(&i, e, &source) == false) { return OtfLineResult::Malformed; }
+        s->handedOn = true;
+        return handleOtfEnter(u, s->time, (uint32_t) a, (uint32_t) s->process, (uint32_t) source) == OTF_RETURN_OK ? OtfLineResult::Ok : OtfLineResult::Aborted;
+
+    case 'L':
+        if ((number == false && i != e && *i != 'X') || s->enabled == false || u->skipEnterLeave) { return OtfLineResult::Ok; }
+        if (parseOtfHex(&i, e, &a) == false && number) { return OtfLineResult::Malformed; } // a is 0 if there is no function
+        if (parseOtfSourceAndEnd(&i, e, &source) == false) { return OtfLineResult::Malformed; }
+        s->handedOn = true;
+        return handleOtfLeave(u, s->time, (uint32_t) a, (uint32_t) s->process, (uint32_t) source) == OTF_RETURN_OK ? OtfLineResult::Ok : OtfLineResult::Aborted;
+
+    case 'S':
+    case 'R':
+        if (number == false || s->enabled == false) { return OtfLineResult::Ok; }
+        // a is the receiver of a send, the sender of a receive
+        if (parseOtfHex(&i, e, &a) == false || parseOtfField(&i, e, 'L', &length) == false || parseOtfField(&i, e, 'T', &tag) == false
+                || parseOtfField(&i, e, 'C', &group) == false || parseOtfSourceAndEnd(&i, e, &source) == false) {
+            return OtfLineResult::Malformed;
+        }
+        s->handedOn = true;
+        if (*b == 'S') {
+            return handleOtfSendMessage   (u, s->time, (uint32_t) s->process, (uint32_t) a, (uint32_t) group, (uint32_t) tag, (uint32_t) length, (uint32_t) source, nullptr) == OTF_RETURN_OK ? OtfLineResult::Ok : OtfLineResult::Aborted;
+        } else {
+            return handleOtfReceiveMessage(u, s->time, (uint32_t) s->process, (uint32_t) a, (uint32_t) group, (uint32_t) tag, (uint32_t) length, (uint32_t) source, nullptr) == OTF_RETURN_OK ? OtfLineResult::Ok : OtfLineResult::Aborted;
+        }
+
+    default:
+        if (otfHexDigits[(u8) *b] < 0) { return OtfLineResult::Ok; } // a record that is not read
+        i = b;
+        if (parseOtfHex(&i, e, &a) == false || i != e) { return OtfLineResult::Malformed; }
+        s->time      = (timestamp_t) a;
+        s->firstTime = std::min(s->firstTime, s->time);
+        s->lastTime  = std::max(s->lastTime , s->time);
+        return OtfLineResult::Ok;
+    }
+}
+
+// parses the decompressed bytes of one otf stream as they arrive. complete lines are split with memchr(), which libc
+// vectorizes, and only the incomplete last line of a chunk is copied.
+class OtfStreamParser {
+public:
+    enum class State {
+        Parsing,
+        NotShortFormat, // or a record that can not be parsed, e.g. a number that is too long. found before anything
+                        // was handed on, so that the otf library can read the stream instead
+        Aborted,        // see RawTrace::setCancelFlag()
     };
 
-    QMap<OTF2_LocationRef, QQueue<IreceiveRequest>> ireceiveRequests;
-    QMap<OTF2_LocationRef, QQueue<Isend>>           isends;
+    OtfStreamParser(const QString& fileName, const QList<process_t>& ps, EventUserData* u) : _fileName(fileName), _processes(ps.toSet()), _u(u) {
+        _s.processes = &_processes;
+    }
+    OtfStreamParser(const OtfStreamParser&) = delete;
+    OtfStreamParser& operator=(const OtfStreamParser&) = delete;
+
+    // parses the complete lines of the next size bytes. the incomplete last line waits for the next call, unless atEnd
+    State parse(const char* data, int size, bool atEnd) {
+        if (_state != State::Parsing) { return _state; }
+
+        if (size == 0) { // e.g. parse(nullptr, 0, true) at the end, which memchr() must not see
+            if (atEnd && _carry.isEmpty() == false) {
+                _state = parseLines(_carry.constData(), _carry.constData() + _carry.size());
+                _carry.resize(0);
+            }
+            return _state;
+        }
+
+        const char* b = data;
+        const char* e = data + size;
+
+        if (_carry.isEmpty() == false) {
+            const char* newline = (const char*) memchr(b, '\n', e - b);
+            if (newline == nullptr && atEnd == false) {
+                _carry.append(b, size);
+                return _state;
+            }
+            const char* lineEnd = newline != nullptr ? newline : e;
+            _carry.append(b, (int) (lineEnd - b));
+            _state = parseLines(_carry.constData(), _carry.constData() + _carry.size());
+            _carry.resize(0);
+            b = newline != nullptr ? newline + 1 : e;
+        }
+
+        const char* complete = e; // end of the complete lines
+        if (atEnd == false) {
+            while (complete > b && complete[-1] != '\n') { complete -= 1; }
+        }
+
+        if (_state == State::Parsing) { _state = parseLines(b, complete); }
+        if (_state == State::Parsing) { _carry.append(complete, (int) (e - complete)); }
+        return _state;
+    }
+
+    // whether records have been handed on. until then the otf library can still read the stream instead
+    bool handedOn() const { return _s.handedOn; }
+
+    // after the last parse(). see readOtfTimeRange()
+    void finish() {
+        if (_u->skipEnterLeave) {
+            _u->beginTime = std::min(_u->beginTime, _s.firstTime);
+            _u->endTime   = std::max(_u->endTime  , _s.lastTime );
+        }
+    }
+
+private:
+    QString         _fileName;
+    QSet<process_t> _processes;
+    EventUserData*  _u;
+    OtfParserState  _s;
+    QByteArray      _carry; // incomplete last line of the previous chunk
+    bool            _checkedFormat = false; // of the first chunk, see isShortOtfFormat()
+    State           _state         = State::Parsing;
+
+    State parseLines(const char* b, const char* e) {
+        if (_checkedFormat == false && b < e) {
+            if (isShortOtfFormat(b, e) == false) { return State::NotShortFormat; }
+            _checkedFormat = true;
+        }
+
+        for (const char* line = b; line < e;) {
+            const char* lineEnd = (const char*) memchr(line, '\n', e - line);
+            if (lineEnd == nullptr) { lineEnd = e; }
+
+            switch (parseOtfLine(line, lineEnd, &_s, _u)) {
+            case OtfLineResult::Ok:
+                break;
+            case OtfLineResult::Aborted:
+                return State::Aborted;
+            case OtfLineResult::Malformed:
+                if (_s.handedOn == false) { return State::NotShortFormat; }
+                qerr << "malformed record \"" << QByteArray(line, (int) (lineEnd - line)) << "\" in \"" << _fileName << "\". aborting.\n";
+                assert(false);
+                break;
+            }
+
+            line = lineEnd + 1;
+        }
+        return State::Parsing;
+    }
+};
+
+// reads the events of ps from one otf stream file into u, reading, inflating and parsing in turn. returns false if
+// the file can not be read or is not in the short format, both before anything has been handed on, so that the otf
+// library can read it instead. if it can not be read later on, ps go to u->failedProcesses.
+static bool readOtfStreamNatively(const QString& fileName, const QList<process_t>& ps, EventUserData* u) {
+    QFile file(fileName);
+    if (file.open(QIODevice::ReadOnly) == false) { return false; }
+    adviseSequentialRead(&file);
+
+    const bool compressed = fileName.endsWith(".z");
+
+    OtfInflater     inflater;
+    OtfStreamParser parser(fileName, ps, u);
+    auto            state = OtfStreamParser::State::Parsing;
+    bool            ok    = true;
+
+    QByteArray block(otfBlockSize, Qt::Uninitialized);
+    while (ok && state == OtfStreamParser::State::Parsing) {
+        auto n = file.read(block.data(), block.size());
+        if (n <= 0) { ok = n == 0; break; }
+
+        if (compressed) {
+            ok = inflater.feed(block.constData(), (int) n, [&parser, &state](const char* data, int size) {
+                state = parser.parse(data, size, false);
+                return state == OtfStreamParser::State::Parsing;
+            });
+        } else {
+            state = parser.parse(block.constData(), (int) n, false);
+        }
+    }
+
+    if (ok && state == OtfStreamParser::State::Parsing) { state = parser.parse(nullptr, 0, true); }
+
+    if (ok == false) {
+        if (parser.handedOn() == false) { return false; }
+        qerr << "could not read \"" << fileName << "\", its processes are not loaded.\n";
+        foreach (auto p, ps) { u->failedProcesses.insert(p); }
+        return true;
+    }
+
+    switch (state) {
+    case OtfStreamParser::State::NotShortFormat: return false;
+    case OtfStreamParser::State::Aborted:        return true;
+    case OtfStreamParser::State::Parsing:        break;
+    }
+
+    parser.finish();
+    u->statistics.bytesRead += file.size();
+    return true;
+}
+
+// otf streams ///////////////////////////////////////////////////////////////
+
+using OtfStreams = QMap<uint32_t /*stream*/, QList<process_t>>;
+
+// the otf streams that contain ps
+static OtfStreams otfStreams(Otf* otf, const QList<process_t>& ps) {
+    assert(otf->which == Otf::Which::Otf1);
+
+    auto mc = OTF_Reader_getMasterControl(otf->r);
+
+    OtfStreams ret;
+    foreach (auto p, ps) {
+        ret[OTF_MasterControl_mapReverse(mc, (uint32_t) p)].append(p);
+    }
+    return ret;
+}
+
+static OtfStreams otfStreams(const QString& traceFileName, const QList<process_t>& ps) {
+    Otf otf;
+    Otf_init(&otf);
+    Otf_open(traceFileName, &otf);
+
+    auto ret = otfStreams(&otf, ps);
+
+    Otf_finalize(&otf);
+    return ret;
+}
+
+// splits streams into at most partCount parts
+static QList<OtfStreams> partitionOtfStreams(const OtfStreams& streams, int partCount) {
+    QList<OtfStreams> parts;
+    int i = 0;
+    QMapIterator<uint32_t, QList<process_t>> j(streams);
+    while (j.hasNext()) {
+        j.next();
+        if (parts.size() < partCount) { parts.append(OtfStreams()); }
+        parts[i % partCount].insert(j.key(), j.value());
+        i += 1;
+    }
+    return parts;
+}
+
+// reads the events of all processes in ps with the otf library and one reader, i.e. one pass over their streams
+static void readOtfEventsWithLibrary(const QString& traceFileName, const QList<process_t>& ps, EventUserData* u) {
+    Otf otf;
+    Otf_init(&otf);
+    Otf_open(traceFileName, &otf);
+    assert(otf.which == Otf::Which::Otf1);
+
+    OTF_Reader_setProcessStatusAll(otf.r, 0);
+    foreach (auto p, ps) {
+        OTF_Reader_setProcessStatus(otf.r, p, 1);
+    }
+
+    setOtfEventHandlers(&otf, u);
+
+    OTF_Reader_readEvents(otf.r, otf.h);
+
+    readOtfTimeRange(&otf, u);
+    readOtfBytes(&otf, u);
+
+    Otf_finalize(&otf);
+}
+
+// reads the events of the processes of the given streams, one pass over every stream. with
+// EventUserData::nativeOtfParsing the streams are parsed by readOtfStreamNatively() where possible, the others
+// are read by the otf library. otf only.
+static void readOtfEvents(const QString& traceFileName, const OtfStreams& streams, EventUserData* u) {
+    QList<process_t> ps; // left to the otf library
+    QMapIterator<uint32_t, QList<process_t>> i(streams);
+    while (i.hasNext()) {
+        i.next();
+        if (u->nativeOtfParsing && readOtfStreamNatively(otfEventFileName(traceFileName, i.key()), i.value(), u)) { continue; }
+        ps += i.value();
+    }
+
+    if (ps.isEmpty() == false) { readOtfEventsWithLibrary(traceFileName, ps, u); }
+}
+
+// part of a stream file on its way through readOtfStreamsPipelined()
+struct OtfBlock {
+    int        stream; // index into the streams of the lane
+    QByteArray data;
+    bool       last;   // of the stream
+    bool       failed; // the file could not be read or inflated. last is set, too
 };
 
+// native parsing in three stages, so that reading the files, inflating and parsing overlap:
+// * one thread per lane reads its stream files, in large blocks and with read-ahead by the kernel
+// * one thread per lane inflates its streams
+// * one thread per lane parses its streams into its EventUserData in (*buffers)[lane]
+// every lane reads the streams of one part in order. the stages are connected by a BoundedQueue per lane, so
+// memory stays below 2 * otfLaneCapacity per lane plus the blocks in the hands of the threads. streams that are not
+// in the short format are read by the otf library afterwards. otf only.
+static void readOtfStreamsPipelined(const QString& traceFileName, const QList<OtfStreams>& lanes, std::vector<EventUserData>* buffers, const std::function<void(process_t)>& progress) {
+    const int laneCount = lanes.size();
+    assert((int) buffers->size() >= laneCount);
+
+    if (laneCount == 0) { return; }
+
+    QVector<QVector<QPair<QString /*file name*/, QList<process_t>>>> streams(laneCount);
+    for (int l = 0; l < laneCount; l += 1) {
+        QMapIterator<uint32_t, QList<process_t>> i(lanes[l]);
+        while (i.hasNext()) {
+            i.next();
+            streams[l].append(qMakePair(otfEventFileName(traceFileName, i.key()), i.value()));
+        }
+    }
+
+    std::vector<std::unique_ptr<BoundedQueue<OtfBlock>>> compressed, decompressed;
+    for (int l = 0; l < laneCount; l += 1) {
+        compressed  .emplace_back(new BoundedQueue<OtfBlock>(otfLaneCapacity));
+        decompressed.emplace_back(new BoundedQueue<OtfBlock>(otfLaneCapacity));
+    }
+
+    // every lane has its own reader, so that a lane whose queue is full does not hold up the others
+    std::vector<std::thread> readers;
+    for (int l = 0; l < laneCount; l += 1) {
+        readers.emplace_back([&streams, &compressed, l]() {
+            bool closed = false; // by the lane, which stopped early
+
+            for (int i = 0; i < streams[l].size() && closed == false; i += 1) {
+                QFile file(streams[l][i].first);
+                if (file.open(QIODevice::ReadOnly) == false) {
+                    closed = compressed[l]->push(OtfBlock{i, QByteArray(), true, true}, 0) == false;
+                    continue;
+                }
+                adviseSequentialRead(&file);
+
+                for (bool last = false; last == false && closed == false;) {
+                    QByteArray block(otfBlockSize, Qt::Uninitialized);
+                    auto n = file.read(block.data(), block.size());
+                    block.resize((int) std::max((qint64) 0, n));
+                    last = n <= 0 || file.atEnd();
+                    closed = compressed[l]->push(OtfBlock{i, block, last, n < 0}, block.size()) == false;
+                }
+            }
+
+            compressed[l]->close();
+        });
+    }
+
+    std::vector<std::thread> inflaters;
+    for (int l = 0; l < laneCount; l += 1) {
+        inflaters.emplace_back([&streams, &compressed, &decompressed, l]() {
+            OtfInflater inflater;
+            OtfBlock    in;
+            int         stream = -1;
+            bool        failed = false;
+
+            while (compressed[l]->pop(&in)) {
+                if (in.stream != stream) {
+                    stream = in.stream;
+                    failed = false;
+                    inflater.reset();
+                }
+                if (failed) { continue; } // the rest of a broken stream
+
+                failed = in.failed;
+                if (failed == false && streams[l][stream].first.endsWith(".z")) {
+                    failed = inflater.feed(in.data.constData(), in.data.size(), [&decompressed, l, stream](const char* data, int size) {
+                        return decompressed[l]->push(OtfBlock{stream, QByteArray(data, size), false, false}, size);
+                    }) == false;
+                } else if (failed == false) {
+                    decompressed[l]->push(OtfBlock{stream, in.data, false, false}, in.data.size());
+                }
+
+                if (in.last || failed) { decompressed[l]->push(OtfBlock{stream, QByteArray(), true, failed}, 0); }
+            }
+
+            decompressed[l]->close();
+        });
+    }
+
+    QVector<QList<process_t>> fallback(laneCount); // not in the short format, left to the otf library
+
+    parallelFor(laneCount, laneCount, [&streams, &compressed, &decompressed, &fallback, buffers, &progress](int l, int thread) {
+        (void) thread;
+        auto* u = &(*buffers)[l];
+
+        std::unique_ptr<OtfStreamParser> parser;
+        OtfBlock chunk;
+        int      stream = -1;
+        bool     skip   = false; // the rest of a stream that is left to the otf library
+
+        while (decompressed[l]->pop(&chunk)) {
+            if (chunk.stream != stream) {
+                stream = chunk.stream;
+                skip   = false;
+                parser.reset(new OtfStreamParser(streams[l][stream].first, streams[l][stream].second, u));
+            }
+            if (skip) { continue; }
+
+            const auto& fileName = streams[l][stream].first;
+
+            if (chunk.failed) {
+                if (parser->handedOn()) { // the otf library would hand them on again, see readOtfStreamNatively()
+                    qerr << "could not read \"" << fileName << "\", its processes are not loaded.\n";
+                    foreach (auto p, streams[l][stream].second) { u->failedProcesses.insert(p); }
+                } else {
+                    fallback[l] += streams[l][stream].second;
+                }
+                skip = true;
+                continue;
+            }
+
+            auto state = parser->parse(chunk.data.constData(), chunk.data.size(), chunk.last);
+
+            if (state == OtfStreamParser::State::Aborted) { // stop the other stages of this lane
+                compressed  [l]->close();
+                decompressed[l]->close();
+                return;
+            }
+            if (state == OtfStreamParser::State::NotShortFormat) {
+                fallback[l] += streams[l][stream].second;
+                skip = true;
+                continue;
+            }
+            if (chunk.last) {
+                parser->finish();
+                u->statistics.bytesRead += QFileInfo(fileName).size();
+                if (progress) { foreach (auto p, streams[l][stream].second) { progress(p); } }
+            }
+        }
+    });
+
+    for (auto& t : readers)   { t.join(); }
+    for (auto& t : inflaters) { t.join(); }
+
+    parallelFor(laneCount, laneCount, [&traceFileName, &fallback, buffers, &progress](int l, int thread) {
+        (void) thread;
+        if (fallback[l].isEmpty()) { return; }
+        readOtfEventsWithLibrary(traceFileName, fallback[l], &(*buffers)[l]);
+        if (progress) { foreach (auto p, fallback[l]) { progress(p); } }
+    });
+}
+
+// reads the events of p into u. touches no RawTrace state, so it can run concurrently for different processes.
+static void readEvents(const QString& traceFileName, process_t p, EventUserData* u) {
+    Otf otf;
+    Otf_init(&otf);
+    Otf_open(traceFileName, &otf);
+
+    if (otf.which == Otf::Which::Otf1 && u->nativeOtfParsing) {
+        auto streams = otfStreams(&otf, {p});
+        Otf_finalize(&otf);
+        readOtfEvents(traceFileName, streams, u);
+        return;
+    }
+
+    if (otf.which == Otf::Which::Otf1) {
+        OTF_Reader_setProcessStatusAll(otf.r, 0);
+        OTF_Reader_setProcessStatus(otf.r, p, 1);
+
+        setOtfEventHandlers(&otf, u);
+
+        OTF_Reader_readEvents(otf.r, otf.h);
+
+        readOtfTimeRange(&otf, u);
+        readOtfBytes(&otf, u);
+    } else {
+        OTF2_Reader_SelectLocation(otf.r2, p);
+
+        bool successfullyOpenedDefinitions = OTF2_Reader_OpenDefFiles(otf.r2) == OTF2_SUCCESS;
+
+        OTF2_Reader_OpenEvtFiles(otf.r2);
+
+        if (successfullyOpenedDefinitions) { /* needed so otf2 can apply a mapping to map local id's to global ones */
+            OTF2_DefReader* dr = OTF2_Reader_GetDefReader(otf.r2, p);
+            if (dr != nullptr) {
+                uint64_t dummy = 0;
+                OTF2_Reader_ReadAllLocalDefinitions(otf.r2, dr, &dummy);
+                OTF2_Reader_CloseDefReader(otf.r2, dr);
+            }
+        }
+        OTF2_Reader_GetEvtReader(otf.r2, p); /* discard return value */
+
+        if (successfullyOpenedDefinitions) { OTF2_Reader_CloseDefFiles(otf.r2); }
+
+        OTF2_GlobalEvtReaderCallbacks_SetMpiSendCallback            (otf.he2, &handleOtf2MpiSend            );
+        OTF2_GlobalEvtReaderCallbacks_SetMpiIsendCallback           (otf.he2, &handleOtf2MpiIsend           );
+        OTF2_GlobalEvtReaderCallbacks_SetMpiIsendCompleteCallback   (otf.he2, &handleOtf2MpiIsendComplete   );
+        OTF2_GlobalEvtReaderCallbacks_SetMpiRecvCallback            (otf.he2, &handleOtf2MpiRecv            );
+        OTF2_GlobalEvtReaderCallbacks_SetMpiIrecvCallback           (otf.he2, &handleOtf2MpiIrecv           );
+        OTF2_GlobalEvtReaderCallbacks_SetMpiIrecvRequestCallback    (otf.he2, &handleOtf2MpiIrecvRequest    );
+        OTF2_GlobalEvtReaderCallbacks_SetMpiRequestCancelledCallback(otf.he2, &handleOtf2MpiRequestCancelled);
+        if (u->skipEnterLeave == false) {
+            OTF2_GlobalEvtReaderCallbacks_SetEnterCallback          (otf.he2, &handleOtf2Enter              );
+            OTF2_GlobalEvtReaderCallbacks_SetLeaveCallback          (otf.he2, &handleOtf2Leave              );
+        }
+
+        auto er = OTF2_Reader_GetGlobalEvtReader(otf.r2);
+
+        OTF2_Reader_RegisterGlobalEvtCallbacks(otf.r2, er, otf.he2, u);
+
+        uint64_t dummyEventsRead;
+        OTF2_Reader_ReadAllGlobalEvents(otf.r2, er, &dummyEventsRead);
+
+        OTF2_Reader_CloseGlobalEvtReader(otf.r2, er);
+        OTF2_Reader_CloseEvtFiles(otf.r2);
+
+        u->statistics.bytesRead += otf2EventFileSize(traceFileName, p);
+    }
+
+    Otf_finalize(&otf);
+}
+
+// reads the events of all locations with one reader. local definitions are read once per location, then every
+// location is read by its own local event reader, in parallel. (*perLocation)[i] receives the events of locations[i],
+// so the isend/ireceive bookkeeping stays per location. otf2 only.
+static void readOtf2Events(const QString& traceFileName, const QList<process_t>& locations, int threadCount, std::vector<EventUserData>* perLocation, const std::function<void(process_t)>& progress) {
+    assert((int) perLocation->size() == locations.size());
+
+    Otf otf;
+    Otf_init(&otf);
+    Otf_open(traceFileName, &otf);
+    assert(otf.which == Otf::Which::Otf2);
+
+    OTF2_Pthread_Reader_SetLockingCallbacks(otf.r2, nullptr); // needed to use different event readers of one reader concurrently
+
+    foreach (auto l, locations) {
+        OTF2_Reader_SelectLocation(otf.r2, l);
+    }
+
+    bool successfullyOpenedDefinitions = OTF2_Reader_OpenDefFiles(otf.r2) == OTF2_SUCCESS;
+
+    OTF2_Reader_OpenEvtFiles(otf.r2);
+
+    QList<OTF2_EvtReader*> evtReaders;
+
+    foreach (auto l, locations) {
+        if (successfullyOpenedDefinitions) { /* needed so otf2 can apply a mapping to map local id's to global ones */
+            OTF2_DefReader* dr = OTF2_Reader_GetDefReader(otf.r2, l);
+            if (dr != nullptr) {
+                uint64_t dummy = 0;
+                OTF2_Reader_ReadAllLocalDefinitions(otf.r2, dr, &dummy);
+                OTF2_Reader_CloseDefReader(otf.r2, dr);
+            }
+        }
+        evtReaders.append(OTF2_Reader_GetEvtReader(otf.r2, l));
+    }
+
+    if (successfullyOpenedDefinitions) { OTF2_Reader_CloseDefFiles(otf.r2); }
+
+    OTF2_EvtReaderCallbacks_SetMpiSendCallback            (otf.hle2, &handleOtf2LocalMpiSend            );
+    OTF2_EvtReaderCallbacks_SetMpiIsendCallback           (otf.hle2, &handleOtf2LocalMpiIsend           );
+    OTF2_EvtReaderCallbacks_SetMpiIsendCompleteCallback   (otf.hle2, &handleOtf2LocalMpiIsendComplete   );
+    OTF2_EvtReaderCallbacks_SetMpiRecvCallback            (otf.hle2, &handleOtf2LocalMpiRecv            );
+    OTF2_EvtReaderCallbacks_SetMpiIrecvCallback           (otf.hle2, &handleOtf2LocalMpiIrecv           );
+    OTF2_EvtReaderCallbacks_SetMpiIrecvRequestCallback    (otf.hle2, &handleOtf2LocalMpiIrecvRequest    );
+    OTF2_EvtReaderCallbacks_SetMpiRequestCancelledCallback(otf.hle2, &handleOtf2LocalMpiRequestCancelled);
+    if (perLocation->empty() == false && perLocation->front().skipEnterLeave == false) {
+        OTF2_EvtReaderCallbacks_SetEnterCallback          (otf.hle2, &handleOtf2LocalEnter              );
+        OTF2_EvtReaderCallbacks_SetLeaveCallback          (otf.hle2, &handleOtf2LocalLeave              );
+    }
+
+    for (int i = 0; i < evtReaders.size(); i += 1) {
+        OTF2_Reader_RegisterEvtCallbacks(otf.r2, evtReaders[i], otf.hle2, &(*perLocation)[i]);
+    }
+
+    parallelFor(evtReaders.size(), threadCount, [&traceFileName, &otf, &evtReaders, &locations, perLocation, &progress](int i, int thread) {
+        (void) thread;
+        auto& u = (*perLocation)[i];
+        {
+            ScopedTimer timer(&u.statistics.processes[locations[i]], CLOCK_THREAD_CPUTIME_ID);
+            uint64_t dummyEventsRead;
+            OTF2_Reader_ReadAllLocalEvents(otf.r2, evtReaders[i], &dummyEventsRead);
+        }
+        u.statistics.bytesRead += otf2EventFileSize(traceFileName, locations[i]);
+        if (progress) { progress(locations[i]); }
+    });
+
+    foreach (auto er, evtReaders) {
+        OTF2_Reader_CloseEvtReader(otf.r2, er);
+    }
+    OTF2_Reader_CloseEvtFiles(otf.r2);
+
+    Otf_finalize(&otf);
+}
+
+void RawTrace::loadEvents() {
+    assert(_traceFileName != QString());
+
+    loadDefinitions();
+
+    loadEvents(_processes);
+}
+
 void RawTrace::loadEvents(process_t p) {
+    loadEvents(QSet<process_t>{p});
+}
+
+void RawTrace::loadEvents(const QSet<process_t>& ps) {
     assert(_traceFileName != QString());
-    if (_loadedEvents.contains(p)) { return; }
 
-    _sentMessages[p]     = QList<SentMessage>    ();
-    _receivedMessages[p] = QList<ReceivedMessage>();
+    loadDefinitions();
+
+    QList<process_t> processesToLoad;
+    QList<process_t> processesToSkip; // rejected by the filter, so none of their messages would be kept
+    foreach(auto p, ps) {
+        assert(_processes.contains(p));
+        if (loadedEvents(p) == true) { continue; }
+        if (_filter.acceptsProcess(p)) { processesToLoad.append(p); }
+        else                           { processesToSkip.append(p); }
+    }
+    std::sort(processesToLoad.begin(), processesToLoad.end());
+
+    foreach(auto p, processesToSkip) {
+        _loadedEvents[_processIndex[p]] = true;
+        _loadedEventCount += 1;
+        if (_progress) { _progress(p); }
+    }
+
+    if (processesToLoad.isEmpty()) { return; }
+
+    ScopedTimer timer(&_statistics.events);
+
+    if (_streamingMatching && _matcher == nullptr) { _matcher.reset(new StreamingMatcher(_processIndex)); }
+
+    // every thread reads with its own otf handles into its own buffers. they are merged afterwards.
+    int threadCount = std::max(1, std::min(resolveThreadCount(_loadThreadCount), processesToLoad.size()));
+
+    EventUserData prototype(_localRankToLocation, &_filter, _matcher.get());
+    prototype.skipEnterLeave   = _skipEnterLeave;
+    prototype.nativeOtfParsing = _nativeOtfParsing;
+    prototype.cancel           = _cancel;
+
+    std::vector<EventUserData> buffers;
+
+    if (_loadStrategy == LoadStrategy::Bulk && _otf2 == false) {
+        buffers.resize(threadCount, prototype);
+
+        auto parts = partitionOtfStreams(otfStreams(_traceFileName, processesToLoad), threadCount);
+
+        if (_nativeOtfParsing) {
+            readOtfStreamsPipelined(_traceFileName, parts, &buffers, _progress); // one lane per part
+        } else {
+            parallelFor(parts.size(), threadCount, [this, &parts, &buffers](int i, int thread) {
+                if (isCancelled()) { return; }
+                readOtfEvents(_traceFileName, parts[i], &buffers[thread]);
+                if (_progress) { foreach (const auto& ps, parts[i]) { foreach (auto p, ps) { _progress(p); } } }
+            });
+        }
+    } else if (_loadStrategy == LoadStrategy::Bulk && _otf2 == true) {
+        buffers.resize(processesToLoad.size(), prototype); // one per location
+
+        readOtf2Events(_traceFileName, processesToLoad, threadCount, &buffers, _progress);
+    } else {
+        buffers.resize(threadCount, prototype);
+
+        parallelFor(processesToLoad.size(), threadCount, [this, &processesToLoad, &buffers](int i, int thread) {
+            if (isCancelled()) { return; }
+            {
+                ScopedTimer timer(&buffers[thread].statistics.processes[processesToLoad[i]], CLOCK_THREAD_CPUTIME_ID);
+                readEvents(_traceFileName, processesToLoad[i], &buffers[thread]);
+            }
+            if (_progress) { _progress(processesToLoad[i]); }
+        });
+    }
+
+    if (isCancelled()) { return; } // the buffers are incomplete
+
+    QSet<process_t> failedProcesses; // only partially read, see EventUserData::failedProcesses
+    for (auto& u : buffers) {
+        failedProcesses += u.failedProcesses;
+        foreach (auto p, u.failedProcesses) {
+            u.sentMessages    .remove(p);
+            u.receivedMessages.remove(p);
+        }
+    }
+
+    foreach(auto p, processesToLoad) {
+        if (failedProcesses.contains(p)) { continue; }
+        _loadedEvents[_processIndex[p]] = true;
+        _loadedEventCount += 1;
+    }
+
+    for (auto& u : buffers) {
+        mergeEvents(&u.sentMessages, &u.receivedMessages, u.beginTime, u.endTime);
+        addReadStatistics(&_statistics, u.statistics);
+    }
 
-    Otf otf;
-    Otf_init(&otf);
-    Otf_open(_traceFileName, &otf);
+    foreach(auto p, processesToLoad) {
+        _statistics.allocations += _sentMessages[_processIndex[p]].chunkCount() + _receivedMessages[_processIndex[p]].chunkCount();
+    }
 
-    EventUserData u{_localRankToLocation, &_sentMessages, &_receivedMessages, &_beginTime, &_endTime, QMap<OTF2_LocationRef, QQueue<EventUserData::IreceiveRequest>>{}, QMap<OTF2_LocationRef, QQueue<EventUserData::Isend>>{}};
+    if (_skipEnterLeave && _otf2) {
+        _beginTime = std::min(_beginTime, _clockBeginTime);
+        _endTime   = std::max(_endTime  , _clockEndTime  );
+    }
+}
 
-    if (otf.which == Otf::Which::Otf1) {
-        OTF_Reader_setProcessStatusAll(otf.r, 0);
-        OTF_Reader_setProcessStatus(otf.r, p, 1);
+void RawTrace::unloadEvents(process_t p) {
+    assert(_matcher == nullptr); // matched messages can not be unloaded per process
+    if (loadedEvents(p) == false) { return; }
 
-        OTF_HandlerArray_setHandler        (otf.h, (OTF_FunctionPointer*) handleOtfSendMessage   , OTF_SEND_RECORD   );
-        OTF_HandlerArray_setFirstHandlerArg(otf.h, &u                                            , OTF_SEND_RECORD   );
-        OTF_HandlerArray_setHandler        (otf.h, (OTF_FunctionPointer*) handleOtfReceiveMessage, OTF_RECEIVE_RECORD);
-        OTF_HandlerArray_setFirstHandlerArg(otf.h, &u                                            , OTF_RECEIVE_RECORD);
-        OTF_HandlerArray_setHandler        (otf.h, (OTF_FunctionPointer*) handleOtfEnter         , OTF_ENTER_RECORD  );
-        OTF_HandlerArray_setFirstHandlerArg(otf.h, &u                                            , OTF_ENTER_RECORD  );
-        OTF_HandlerArray_setHandler        (otf.h, (OTF_FunctionPointer*) handleOtfLeave         , OTF_LEAVE_RECORD  );
-        OTF_HandlerArray_setFirstHandlerArg(otf.h, &u                                            , OTF_LEAVE_RECORD  );
+    processindex_t i = _processIndex[p];
+    _sentMessages    [i].clear();
+    _receivedMessages[i].clear();
+    _loadedEvents    [i] = false;
+    _loadedEventCount   -= 1;
+}
 
-        OTF_Reader_readEvents(otf.r, otf.h);
-    } else {
-        OTF2_Reader_SelectLocation(otf.r2, p);
+void RawTrace::setLoadStrategy(LoadStrategy s) {
+    _loadStrategy = s;
+}
 
-        bool successfullyOpenedDefinitions = OTF2_Reader_OpenDefFiles(otf.r2) == OTF2_SUCCESS;
+void RawTrace::setStreamingMatching(bool b) {
+    assert(_loadedEventCount == 0);
+    _streamingMatching = b;
+}
 
-        OTF2_Reader_OpenEvtFiles(otf.r2);
+void RawTrace::setProgressCallback(const std::function<void(process_t)>& f) {
+    _progress = f;
+}
 
-        if (successfullyOpenedDefinitions) { /* needed so otf2 can apply a mapping to map local id's to global ones */
-            OTF2_DefReader* dr = OTF2_Reader_GetDefReader(otf.r2, p);
-            if (dr != nullptr) {
-                uint64_t dummy = 0;
-                OTF2_Reader_ReadAllLocalDefinitions(otf.r2, dr, &dummy);
-                OTF2_Reader_CloseDefReader(otf.r2, dr);
-            }
-        }
-        OTF2_Reader_GetEvtReader(otf.r2, p); /* discard return value */
+void RawTrace::setCancelFlag(const std::atomic<bool>* cancel) {
+    _cancel = cancel;
+}
 
-        if (successfullyOpenedDefinitions) { OTF2_Reader_CloseDefFiles(otf.r2); }
+bool RawTrace::isCancelled() const {
+    return _cancel != nullptr && _cancel->load();
+}
 
-        OTF2_GlobalEvtReaderCallbacks_SetMpiSendCallback            (otf.he2, &handleOtf2MpiSend            );
-        OTF2_GlobalEvtReaderCallbacks_SetMpiIsendCallback           (otf.he2, &handleOtf2MpiIsend           );
-        OTF2_GlobalEvtReaderCallbacks_SetMpiIsendCompleteCallback   (otf.he2, &handleOtf2MpiIsendComplete   );
-        OTF2_GlobalEvtReaderCallbacks_SetMpiRecvCallback            (otf.he2, &handleOtf2MpiRecv            );
-        OTF2_GlobalEvtReaderCallbacks_SetMpiIrecvCallback           (otf.he2, &handleOtf2MpiIrecv           );
-        OTF2_GlobalEvtReaderCallbacks_SetMpiIrecvRequestCallback    (otf.he2, &handleOtf2MpiIrecvRequest    );
-        OTF2_GlobalEvtReaderCallbacks_SetMpiRequestCancelledCallback(otf.he2, &handleOtf2MpiRequestCancelled);
-        OTF2_GlobalEvtReaderCallbacks_SetEnterCallback              (otf.he2, &handleOtf2Enter              );
-        OTF2_GlobalEvtReaderCallbacks_SetLeaveCallback              (otf.he2, &handleOtf2Leave              );
+void RawTrace::setSkipEnterLeave(bool b) {
+    assert(_loadedEventCount == 0);
+    _skipEnterLeave = b;
+}
 
-        auto er = OTF2_Reader_GetGlobalEvtReader(otf.r2);
+void RawTrace::setNativeOtfParsing(bool b) {
+    assert(_loadedEventCount == 0);
+    _nativeOtfParsing = b;
+}
 
-        OTF2_Reader_RegisterGlobalEvtCallbacks(otf.r2, er, otf.he2, &u);
+void RawTrace::setFilter(const Filter& f) {
+    assert(_loadedEventCount == 0);
+    _filter = f;
+}
 
-        uint64_t dummyEventsRead;
-        OTF2_Reader_ReadAllGlobalEvents(otf.r2, er, &dummyEventsRead);
+void RawTrace::setMatchThreadCount(int n) {
+    assert(n >= 0);
+    _matchThreadCount = n;
+}
 
-        OTF2_Reader_CloseGlobalEvtReader(otf.r2, er);
-        OTF2_Reader_CloseEvtFiles(otf.r2);
+void RawTrace::setLoadThreadCount(int n) {
+    assert(n >= 0);
+    _loadThreadCount = n;
+}
+
+// moves thread local results into the RawTrace
+void RawTrace::mergeEvents(QMap<process_t, SentMessageList>* sentMessages, QMap<process_t, ReceivedMessageList>* receivedMessages, timestamp_t beginTime, timestamp_t endTime) {
+    QMutableMapIterator<process_t, SentMessageList> i(*sentMessages);
+    while (i.hasNext()) {
+        i.next();
+        assert(_processIndex.contains(i.key()));
+        _sentMessages[_processIndex[i.key()]] += std::move(i.value()); // moves chunks, copies no messages
     }
+    sentMessages->clear();
 
-    Otf_finalize(&otf);
+    QMutableMapIterator<process_t, ReceivedMessageList> j(*receivedMessages);
+    while (j.hasNext()) {
+        j.next();
+        assert(_processIndex.contains(j.key()));
+        _receivedMessages[_processIndex[j.key()]] += std::move(j.value());
+    }
+    receivedMessages->clear();
 
-    _loadedEvents.insert(p);
+    _beginTime = std::min(_beginTime, beginTime);
+    _endTime   = std::max(_endTime  , endTime  );
 }
 
 // latest enter/leave for otf and otf2
@@ -305,162 +1618,347 @@ const QMap<process_t, process_t>& RawTrace::processParents() const {
     return _processParents;
 }
 
-const QList<RawTrace::SentMessage>& RawTrace::sentMessages(process_t p) const {
-    assert(_loadedEvents.contains(p));
-    if (_sentMessages.contains(p)) {
-        return _sentMessages.constFind(p).value();
-    } else {
-        return _emptySentMessageList;
-    }
-}
-
-const QList<RawTrace::ReceivedMessage>& RawTrace::receivedMessages(process_t p) const {
-    assert(_loadedEvents.contains(p));
-    if (_receivedMessages.contains(p)) {
-        return _receivedMessages.constFind(p).value();
-    } else {
-        return _emptyReceivedMessageList;
-    }
+const QList<process_t>& RawTrace::orderedProcesses() const {
+    assert(_loadedDefinitions == true);
+    return _orderedProcesses;
 }
 
-void RawTrace::toTrace(Trace* t) {
+processindex_t RawTrace::processIndex(process_t p) const {
     assert(_loadedDefinitions == true);
-    assert(loadedAllEvents() == true);
-
-    assert(t->_beginTime == std::numeric_limits<timestamp_t>::max());
-    assert(t->_endTime   == std::numeric_limits<timestamp_t>::min());
-    assert(t->_processes       .isEmpty());
-    assert(t->_orderedProcesses.isEmpty());
-    assert(t->_processNames    .isEmpty());
-    assert(t->_messages        .isEmpty());
+    return _processIndex.value(p, -1);
+}
 
-    t->_beginTime    = _beginTime;
-    t->_endTime      = _endTime;
+const RawTrace::SentMessageList& RawTrace::sentMessages(process_t p) const {
+    assert(loadedEvents(p));
+    return _sentMessages[_processIndex[p]];
+}
 
-    t->_processes    = _processes;
-    t->_processNames = _processNames;
+const RawTrace::ReceivedMessageList& RawTrace::receivedMessages(process_t p) const {
+    assert(loadedEvents(p));
+    return _receivedMessages[_processIndex[p]];
+}
 
-    QMap<process_t, QList<process_t>> children; // will be the reverse mapping of processParents
+// Vampir Master Timeline order: processes ascending by id, every process directly followed by its children (recursively).
+// Iterative pre-order traversal over sorted child lists. O(P log P).
+static QList<process_t> orderProcesses(const QSet<process_t>& processes, const QMap<process_t, process_t>& parents) {
+    QHash<process_t, QVector<process_t>> children; // will be the reverse mapping of parents
 
-    QMapIterator<process_t, process_t> i(processParents());
+    QMapIterator<process_t, process_t> i(parents);
     while (i.hasNext()) {
         i.next();
-        children[i.value()].append(i.key());
+        if (processes.contains(i.key())) { children[i.value()].append(i.key()); }
     }
 
-    // sort children lists
-    QMutableMapIterator<process_t, QList<process_t>> j(children);
-    while (j.hasNext()) {
-        j.next();
-        auto x = j.value();
-        std::sort(j.value().begin(), j.value().end());
+    for (auto it = children.begin(); it != children.end(); ++it) {
+        std::sort(it.value().begin(), it.value().end());
     }
 
-    auto sortedProcesses = processes().toList(); // QSet is unordered. We need them ordered.
+    auto sortedProcesses = processes.toList(); // QSet is unordered. We need them ordered.
     std::sort(sortedProcesses.begin(), sortedProcesses.end());
 
+    QList<process_t> ret;
     QSet<process_t> added;
+    added.reserve(processes.size());
 
-    // Add process ids to orderedProcesses recursively. Children might be parents of other processes themselves.
-    std::function<void(process_t)> recurse = [&recurse, &sortedProcesses, &children, &added, &t](process_t parent) {
-        foreach (process_t p, sortedProcesses) {
-            if (added.contains(p) || children.contains(parent) == false) { continue; }
-            if (children[parent].contains(p) == false) { continue; }
-            t->_orderedProcesses.append(p);
-            added.insert(p);
+    QVector<QPair<const QVector<process_t>*, int /*next child*/>> stack;
+    const QVector<process_t> noChildren;
 
-            recurse(p);
-        }
+    auto visit = [&ret, &added, &stack, &children, &noChildren](process_t p) {
+        ret.append(p);
+        added.insert(p);
+        auto c = children.constFind(p);
+        stack.append(qMakePair(c != children.constEnd() ? &c.value() : &noChildren, 0));
     };
 
     foreach (process_t p, sortedProcesses) {
         if (added.contains(p)) { continue; }
-        t->_orderedProcesses.append(p);
-        added.insert(p);
+        visit(p);
+
+        // children might be parents of other processes themselves
+        while (stack.isEmpty() == false) {
+            auto& top = stack.last();
+            if (top.second == top.first->size()) {
+                stack.removeLast();
+                continue;
+            }
 
-        recurse(p);
+            process_t c = (*top.first)[top.second];
+            top.second += 1;
+            if (added.contains(c) == false) { visit(c); } // invalidates top
+        }
     }
 
-    // match messages. I.e. transform send/recvs into to Trace::Message structures.
+    return ret;
+}
+
+using ReceiveQueues = QHash<MessageKey, ReceiveQueue>; // of one receiver
+
+// appends the receives of receiver to the fifos of their keys. only the ones from sender, unless that is null
+static void addReceives(process_t receiver, const ReceivedMessageList& received, ReceiveQueues* queues, const process_t* sender = nullptr) {
+    for (const auto& r : received) {
+        if (sender != nullptr && r.sender != *sender) { continue; }
+        (*queues)[MessageKey{r.sender, receiver, r.group, r.tag}].messages.append(r);
+    }
+}
 
-    struct Key {
-        process_t      sender;
-        process_t      receiver;
-        processgroup_t group;
-        messagetag_t   tag;
-        bool operator<(const Key& o) const {
-            if      (sender   < o.sender  ) { return true ; }
-            else if (sender   > o.sender  ) { return false; }
-            if      (receiver < o.receiver) { return true ; }
-            else if (receiver > o.receiver) { return false; }
-            if      (group    < o.group   ) { return true;  }
-            else if (group    > o.group   ) { return false; }
-            return tag < o.tag;
+// messages between two processes with the same group and tag are received in the order they were sent.
+// so every such key has a fifo of receives, which are consumed by the sends in order. with a Filter that needs
+// ordinals, a send takes the receive with its ordinal, see Filter.
+// queues(receiver index) returns the fifos of a receiver, or null if its receives are not known. sends to those are
+// skipped if partial. otherwise, like sends without receive, they count as missing receives.
+template<typename Queues>
+static void matchSender(process_t sender, const SentMessageList& sent, const QHash<process_t, processindex_t>& processIndex, bool partial, Queues&& queues, SenderMatches* m, Diagnostics* d) {
+    m->time    .reserve((int) sent.size());
+    m->duration.reserve((int) sent.size());
+    m->receiver.reserve((int) sent.size());
+    m->length  .reserve((int) sent.size());
+
+    for (const auto& s : sent) {
+        processindex_t receiverIndex = processIndex.value(s.receiver, -1);
+        const ReceiveQueues* qs = receiverIndex != -1 ? queues(receiverIndex) : nullptr;
+        if (partial && qs == nullptr) { continue; }
+
+        auto k = MessageKey{sender, s.receiver, s.group, s.tag};
+
+        const ReceiveQueue* q = nullptr;
+        if (qs != nullptr) {
+            auto it = qs->constFind(k);
+            if (it != qs->constEnd()) {
+                const auto& rs = it.value();
+                while (rs.next < rs.messages.size() && rs.messages[rs.next].ordinal < s.ordinal) { rs.next += 1; } // their sends were filtered, see Filter
+                if (rs.next < rs.messages.size() && rs.messages[rs.next].ordinal == s.ordinal) { q = &rs; }
+            }
         }
-        QString toString() const {
-            QString ret;
-            QTextStream s(&ret);
-            s << "sender " << sender << ", receiver " << receiver << ", group " << group << ", tag " << tag;
-            return ret;
+
+        if (q == nullptr) {
+            m->missingReceives[k] += 1;
+            continue;
         }
-    };
 
-    QMap<Key, QList<ReceivedMessage>> receiveQueues;
+        const auto& r = q->messages[q->next];
 
-    foreach (process_t receiver, processes()) {
-        foreach (const auto& r, receivedMessages(receiver)) {
-            receiveQueues[Key{r.sender, receiver, r.group, r.tag}].append(r);
+        m->time    .append(s.time         );
+        m->duration.append(r.time - s.time);
+        m->receiver.append(receiverIndex  );
+        m->length  .append(s.length       );
+
+        if (s.time > r.time) {
+            d->add(Diagnostics::Category::SendAfterReceive, sender, s.receiver, s.time, r.time - s.time);
+        }
+        if (s.length > r.length) {
+            d->add(Diagnostics::Category::ReceiveTooShort, sender, s.receiver, s.time, s.length - r.length);
         }
+
+        q->next += 1;
+    }
+}
+
+void RawTrace::matchSends(process_t p, SenderMatches* m, Diagnostics* d) const {
+    assert(_matcher == nullptr && loadedEvents(p));
+
+    QHash<processindex_t, ReceiveQueues> receiveQueues; // only the receivers of p, and only their receives from p
+    for (const auto& s : _sentMessages[_processIndex[p]]) {
+        processindex_t i = _processIndex.value(s.receiver, -1);
+        if (i == -1 || _loadedEvents[i] == false || receiveQueues.contains(i)) { continue; }
+        addReceives(s.receiver, _receivedMessages[i], &receiveQueues[i], &p);
     }
 
-    QMap<Key, int /*count*/> missingReceives;
+    auto queues = [&receiveQueues](processindex_t receiver) -> ReceiveQueues* {
+        auto it = receiveQueues.find(receiver);
+        return it != receiveQueues.end() ? &it.value() : nullptr;
+    };
+    matchSender(p, _sentMessages[_processIndex[p]], _processIndex, false, queues, m, d);
+}
+
+void RawTrace::toTrace(Trace* t) {
+    assert(loadedAllEvents() == true);
+    buildTrace(t, false);
+}
+
+void RawTrace::toPartialTrace(Trace* t) {
+    buildTrace(t, true);
+}
+
+// partial: only processes whose events are loaded are used, and only messages between them. nothing is consumed or reported.
+void RawTrace::buildTrace(Trace* t, bool partial) {
+    assert(_loadedDefinitions == true);
 
-    foreach (process_t sender, processes()) {
+    assert(t->_beginTime == std::numeric_limits<timestamp_t>::max());
+    assert(t->_endTime   == std::numeric_limits<timestamp_t>::min());
+    assert(t->_processes       .isEmpty());
+    assert(t->_orderedProcesses.isEmpty());
+    assert(t->_processNames    .isEmpty());
+    assert(t->_messageOffsets  .isEmpty());
 
-        t->_messages[sender] = {};
+    t->_beginTime      = _beginTime;
+    t->_endTime        = _endTime;
 
-        foreach (const auto& s, sentMessages(sender)) {
-            auto k = Key{sender, s.receiver, s.group, s.tag};
+    t->_processes      = _processes;
+    t->_processNames   = _processNames;
+    t->_processParents = _processParents;
 
-            if (receiveQueues.contains(k)) {
-                const auto& r = receiveQueues[k].first();
+    t->_orderedProcesses = _orderedProcesses;
+    t->_processIndex     = _processIndex;
 
-                t->_messages[sender].append(Trace::Message{s.time, r.time - s.time, s.receiver, s.length});
+    // match messages. I.e. transform send/recvs into to Trace::Message structures, see matchSender().
+    // each receiver's fifos are built separately, then the senders are matched in parallel.
+    // a fifo is only ever consumed by the thread matching its sender, so the cursors need no locking.
 
-                if (s.time > r.time) {
-                    qerr << "warning: send (process " << sender << ") did not start before receive (process " << s.receiver << "). delta is " << r.time - s.time << " ticks.\n";
-                }
-                if (s.length > r.length) {
-                    qerr << "warning: receiver (process " << s.receiver << ") receives fewer bytes than sent (process " << sender << "). " << s.length << " > " << r.length << "\n";
-                }
+    ScopedTimer timer(&_statistics.matching);
 
-                receiveQueues[k].removeFirst();
+    const int processCount = _orderedProcesses.size();
+    const int threadCount  = resolveThreadCount(_matchThreadCount);
 
-                if (receiveQueues[k].isEmpty()) {
-                    receiveQueues.remove(k);
+    std::vector<SenderMatches> matches(processCount);
+
+    if (partial == false) { _diagnostics->clear(); }
+
+    if (_matcher != nullptr) { // already matched while reading
+        parallelFor(processCount, threadCount, [this, partial, &matches](int p, int thread) {
+            (void) thread;
+            if (_loadedEvents[p] == false) { return; }
+            _matcher->collect(_orderedProcesses[p], &matches[p], partial == false); // later batches still match into the matcher
+        });
+
+        if (partial == false) {
+            _matcher->collectDiagnostics(_diagnostics.get());
+            _statistics.unmatchedReceives = _matcher->unmatchedReceiveCount();
+
+            assert(_filter.needsOrdinals() || _statistics.unmatchedReceives == 0); // if this happens, receives are done without according sends. To my best knowledge this is illegal.
+
+            _matcher.reset();
+        }
+    } else {
+        std::vector<ReceiveQueues> receiveQueues(processCount); // per receiver
+
+        parallelFor(processCount, threadCount, [this, &receiveQueues](int p, int thread) {
+            (void) thread;
+            if (_loadedEvents[p] == false) { return; }
+            addReceives(_orderedProcesses[p], _receivedMessages[p], &receiveQueues[p]);
+        });
+
+        std::vector<Diagnostics> diagnostics(std::min(threadCount, std::max(1, processCount))); // per thread
+
+        parallelFor(processCount, threadCount, [this, partial, &receiveQueues, &matches, &diagnostics](int p, int thread) {
+            if (_loadedEvents[p] == false) { return; }
+            auto queues = [this, partial, &receiveQueues](processindex_t receiver) -> ReceiveQueues* {
+                return partial && _loadedEvents[receiver] == false ? nullptr : &receiveQueues[receiver];
+            };
+            matchSender(_orderedProcesses[p], _sentMessages[p], _processIndex, partial, queues, &matches[p], &diagnostics[thread]);
+        });
+
+        if (partial == false) {
+            for (const auto& d : diagnostics) { _diagnostics->merge(d); }
+
+            _statistics.unmatchedReceives = 0;
+            for (const auto& queues : receiveQueues) {
+                foreach (const auto& q, queues) {
+                    _statistics.unmatchedReceives += q.messages.size() - q.next;
                 }
+            }
+        }
 
-            } else {
-                if (missingReceives.contains(k) == false) { missingReceives[k] = 0; }
-                missingReceives[k] += 1;
+#ifndef NDEBUG
+        if (partial == false && _filter.needsOrdinals() == false) { // with ordinals, receives of filtered sends stay behind
+            for (const auto& queues : receiveQueues) {
+                foreach (const auto& q, queues) {
+                    assert(q.next == q.messages.size()); // if this happens, receives are done without according sends. To my best knowledge this is illegal.
+                }
             }
         }
+#endif
+    }
+
+    // columns are grouped by sender in _orderedProcesses order
+    t->_messageOffsets.resize(processCount + 1);
+    t->_messageOffsets[0] = 0;
+    for (int p = 0; p < processCount; p += 1) {
+        t->_messageOffsets[p+1] = t->_messageOffsets[p] + matches[p].time.size();
+    }
+
+    s64 messageCount = t->_messageOffsets[processCount];
+    t->_timeStorage    .resize(messageCount);
+    t->_durationStorage.resize(messageCount);
+    t->_receiverStorage.resize(messageCount);
+    t->_lengthStorage  .resize(messageCount);
+
+    timestamp_t*     time     = t->_timeStorage    .data();
+    timestamp_t*     duration = t->_durationStorage.data();
+    processindex_t*  receiver = t->_receiverStorage.data();
+    messagelength_t* length   = t->_lengthStorage  .data();
+
+    parallelFor(processCount, threadCount, [t, &matches, time, duration, receiver, length](int p, int thread) {
+        (void) thread;
+        const auto& m = matches[p];
+        s64 first = t->_messageOffsets[p];
+        std::copy(m.time    .begin(), m.time    .end(), time     + first);
+        std::copy(m.duration.begin(), m.duration.end(), duration + first);
+        std::copy(m.receiver.begin(), m.receiver.end(), receiver + first);
+        std::copy(m.length  .begin(), m.length  .end(), length   + first);
+    });
+
+    t->_time     = time;
+    t->_duration = duration;
+    t->_receiver = receiver;
+    t->_length   = length;
+
+    t->buildTimeIndex(threadCount);
+
+    if (partial) { return; }
+
+    QMap<MessageKey, int /*count*/> missingReceives;
+
+    _statistics.matchedMessages = messageCount;
+    _statistics.missingReceives = 0;
+
+    for (const auto& m : matches) {
+        QMapIterator<MessageKey, int> i(m.missingReceives);
+        while (i.hasNext()) {
+            i.next();
+            missingReceives[i.key()] += i.value();
+            _statistics.missingReceives += i.value();
+        }
     }
 
+    if (_printDiagnostics == false) { return; }
+
+    // one write, qerr flushes on every <<
+    QString warnings;
+    QTextStream s(&warnings);
+    s << _diagnostics->toString();
+
     if (missingReceives.isEmpty() == false) { // there exists sends without receives
-        QMapIterator<Key, int> i(missingReceives);
+        QMapIterator<MessageKey, int> i(missingReceives);
         while (i.hasNext()) {
             i.next();
-            qerr << "warning: key: \""<< i.key().toString() << "\" has " << i.value() << " missing receives.\n";
+            s << "warning: key: \""<< i.key().toString() << "\" has " << i.value() << " missing receives.\n";
         }
     }
 
-    assert(receiveQueues.isEmpty()); // if this happens, receives are done without according sends. To my best knowledge this is illegal.
+    s.flush();
+    if (warnings.isEmpty() == false) { qerr << warnings; }
+}
+
+const Diagnostics& RawTrace::diagnostics() const {
+    return *_diagnostics;
+}
+
+const RawTrace::Statistics& RawTrace::statistics() const {
+    return _statistics;
+}
+
+void RawTrace::setPrintDiagnostics(bool b) {
+    _printDiagnostics = b;
 }
 
 bool RawTrace::loadedAllEvents() const {
     assert(_loadedDefinitions == true);
-    return _loadedEvents.size() == _sentMessages.size();
+    return _loadedEventCount == _orderedProcesses.size();
+}
+
+bool RawTrace::loadedEvents(process_t p) const {
+    processindex_t i = _processIndex.value(p, -1);
+    return i != -1 && _loadedEvents[i];
 }
 
 // otf specifics ////////////////////////////////////////////////////////////
@@ -474,9 +1972,10 @@ static void Otf_init(Otf *otf) {
     assert(otf->h != nullptr);
     otf->r = nullptr;
 
-    otf->hd2 = OTF2_GlobalDefReaderCallbacks_New();
-    otf->he2 = OTF2_GlobalEvtReaderCallbacks_New();
-    otf->r2  = nullptr;
+    otf->hd2  = OTF2_GlobalDefReaderCallbacks_New();
+    otf->he2  = OTF2_GlobalEvtReaderCallbacks_New();
+    otf->hle2 = OTF2_EvtReaderCallbacks_New();
+    otf->r2   = nullptr;
 }
 
 static void Otf_open(const QString& traceFileName, Otf *otf) {
@@ -501,9 +2000,10 @@ static void Otf_finalize(Otf *otf) {
     if (otf->h != nullptr) { OTF_HandlerArray_close(otf->h); otf->h = nullptr; }
     if (otf->f != nullptr) { OTF_FileManager_close(otf->f);  otf->f = nullptr; }
 
-    if (otf->r2  != nullptr) { OTF2_Reader_Close(otf->r2);                     otf->r2  = nullptr; }
-    if (otf->he2 != nullptr) { OTF2_GlobalEvtReaderCallbacks_Delete(otf->he2); otf->he2 = nullptr; }
-    if (otf->hd2 != nullptr) { OTF2_GlobalDefReaderCallbacks_Delete(otf->hd2); otf->hd2 = nullptr; }
+    if (otf->r2   != nullptr) { OTF2_Reader_Close(otf->r2);                     otf->r2   = nullptr; }
+    if (otf->he2  != nullptr) { OTF2_GlobalEvtReaderCallbacks_Delete(otf->he2); otf->he2  = nullptr; }
+    if (otf->hle2 != nullptr) { OTF2_EvtReaderCallbacks_Delete(otf->hle2);      otf->hle2 = nullptr; }
+    if (otf->hd2  != nullptr) { OTF2_GlobalDefReaderCallbacks_Delete(otf->hd2); otf->hd2  = nullptr; }
 }
 
 // unified handlers /////////////////////////////////////////////////////////
@@ -522,20 +2022,70 @@ static int handleDefProcess(void* userData, process_t id, const char* name, proc
 }
 
 static int handleSendMessage(void* userData, timestamp_t time, process_t sender, process_t receiver, processgroup_t group, messagetag_t tag, messagelength_t length) {
-    (void) sender; // is hardcoded into userData
-    (*((EventUserData*) userData)->sentMessages)[sender].append(SentMessage{time, receiver, group, length, tag});
+    auto& u = *((EventUserData*) userData);
+    const auto& f = *u.filter;
+
+    if (cancelled(userData)) { return OTF_RETURN_ABORT; }
+
+    if (u.skipEnterLeave) { handleEnterOrLeave(userData, time); }
+
+    if (f.acceptsKey(sender, receiver, group, tag) == false) { return OTF_RETURN_OK; }
+
+    s64 ordinal = 0;
+    if (f.needsOrdinals()) {
+        ordinal = u.sendOrdinals[MessageKey{sender, receiver, group, tag}]++;
+        if (time < f.beginTime || time >= f.endTime || length < f.minLength) { return OTF_RETURN_OK; }
+    }
+
+    if (u.matcher != nullptr) {
+        u.matcher->send(sender, SentMessage{time, receiver, group, length, tag, ordinal});
+    } else {
+        if (u.lastSentMessages == nullptr || u.lastSender != sender) {
+            u.lastSentMessages = &u.sentMessages[sender]; // stays valid, QMap does not move its values
+            u.lastSender       = sender;
+        }
+        u.lastSentMessages->append(SentMessage{time, receiver, group, length, tag, ordinal});
+    }
     return OTF_RETURN_OK;
 }
 static int handleReceiveMessage(void* userData, timestamp_t time, process_t receiver, process_t sender, processgroup_t group, messagetag_t tag, messagelength_t length) {
-    (void) receiver; // is hardcoded into userData
-    (*((EventUserData*) userData)->receivedMessages)[receiver].append(ReceivedMessage{time, sender, group, length, tag});
+    auto& u = *((EventUserData*) userData);
+    const auto& f = *u.filter;
+
+    if (cancelled(userData)) { return OTF_RETURN_ABORT; }
+
+    if (u.skipEnterLeave) { handleEnterOrLeave(userData, time); }
+
+    if (f.acceptsKey(sender, receiver, group, tag) == false) { return OTF_RETURN_OK; }
+
+    s64 ordinal = 0;
+    if (f.needsOrdinals()) { // no upper bound: receives of sends before endTime may happen after it
+        ordinal = u.receiveOrdinals[MessageKey{sender, receiver, group, tag}]++;
+        if (time < f.beginTime || length < f.minLength) { return OTF_RETURN_OK; }
+    }
+
+    if (u.matcher != nullptr) {
+        u.matcher->receive(receiver, ReceivedMessage{time, sender, group, length, tag, ordinal});
+    } else {
+        if (u.lastReceivedMessages == nullptr || u.lastReceiver != receiver) {
+            u.lastReceivedMessages = &u.receivedMessages[receiver];
+            u.lastReceiver         = receiver;
+        }
+        u.lastReceivedMessages->append(ReceivedMessage{time, sender, group, length, tag, ordinal});
+    }
     return OTF_RETURN_OK;
 }
 
 static void handleEnterOrLeave(void* userData, timestamp_t time) {
     auto& u = *(EventUserData*) userData;
-    *u.beginTime = std::min(*u.beginTime, time);
-    *u.endTime   = std::max(*u.endTime  , time);
+    u.beginTime = std::min(u.beginTime, time);
+    u.endTime   = std::max(u.endTime  , time);
+}
+
+// see RawTrace::setCancelFlag(). checked by every handler that is called per record, so that reading stops soon.
+static bool cancelled(void* userData) {
+    auto& u = *(EventUserData*) userData;
+    return u.cancel != nullptr && u.cancel->load(std::memory_order_relaxed);
 }
 
 // otf handlers /////////////////////////////////////////////////////////////
@@ -547,22 +2097,28 @@ static int handleOtfDefProcess(void* userData, uint32_t stream, uint32_t id, con
 
 static int handleOtfSendMessage(void* userData, uint64_t time, uint32_t sender, uint32_t receiver, uint32_t group, uint32_t tag, uint32_t length, uint32_t source, OTF_KeyValueList* list) {
     (void) source; (void) list;
+    ((EventUserData*) userData)->statistics.sends += 1;
     return handleSendMessage(userData, (timestamp_t) time, (process_t) sender, (process_t) receiver, (processgroup_t) group, (messagetag_t) tag, (messagelength_t) length);
 }
 
 static int handleOtfReceiveMessage(void* userData, uint64_t time, uint32_t receiver, uint32_t sender, uint32_t group, uint32_t tag, uint32_t length, uint32_t source, OTF_KeyValueList* list) {
     (void) source; (void) list;
+    ((EventUserData*) userData)->statistics.receives += 1;
     return handleReceiveMessage(userData, (timestamp_t) time, (process_t) receiver, (process_t) sender, (processgroup_t) group, (messagetag_t) tag, (messagelength_t) length);
 }
 
 static int handleOtfEnter(void* userData, uint64_t time, uint32_t function, uint32_t process, uint32_t source) {
     (void) function; (void) process; (void) source;
+    if (cancelled(userData)) { return OTF_RETURN_ABORT; }
+    ((EventUserData*) userData)->statistics.enters += 1;
     handleEnterOrLeave(userData, time);
     return OTF_RETURN_OK;
 }
 
 static int handleOtfLeave(void* userData, uint64_t time, uint32_t function, uint32_t process, uint32_t source) {
     (void) function; (void) process; (void) source;
+    if (cancelled(userData)) { return OTF_RETURN_ABORT; }
+    ((EventUserData*) userData)->statistics.leaves += 1;
     handleEnterOrLeave(userData, time);
     return OTF_RETURN_OK;
 }
@@ -603,13 +2159,9 @@ static OTF2_CallbackCode handleOtf2DefGroup(void *userData, OTF2_GroupRef group,
     auto& u = *((DefinitionUserData*) userData);
 
     assert(u.localRankToGlobalRank.contains(group) == false);
-    u.localRankToGlobalRank[group] = {};
-    //qerr << "group" << group << ": [";
-    for (uint32_t i = 0; i < numberOfMembers; i += 1) {
-        u.localRankToGlobalRank[group][i] = members[i];
-        //qerr << members[i] << ", ";
-    }
-    //qerr << "] type " << type << ", paradigm " << paradigm << "\n";
+    auto& globalRanks = u.localRankToGlobalRank[group];
+    globalRanks.resize((int) numberOfMembers);
+    std::copy(members, members + numberOfMembers, globalRanks.begin());
 
     if (type == OTF2_GROUP_TYPE_COMM_LOCATIONS && paradigm == OTF2_PARADIGM_MPI) {
         u.locationGroup = group;
@@ -625,21 +2177,48 @@ static OTF2_CallbackCode handleOtf2DefCommunicator(void *userData, OTF2_CommRef
     return OTF2_CALLBACK_SUCCESS;
 }
 
+static OTF2_CallbackCode handleOtf2DefClockProperties(void *userData, uint64_t timerResolution, uint64_t globalOffset, uint64_t traceLength) {
+    (void) timerResolution;
+    auto& u = *((DefinitionUserData*) userData);
+    u.clockBeginTime = (timestamp_t) globalOffset;
+    u.clockEndTime   = (timestamp_t) (globalOffset + traceLength);
+    return OTF2_CALLBACK_SUCCESS;
+}
+
+static OTF2_CallbackCode releaseOtf2Sends(void* userData, OTF2_LocationRef sender) {
+    auto& u = *((EventUserData*) userData);
+    bool ok = u.sendRequests[sender].release([userData, sender](const SentMessage& m) {
+        return handleSendMessage(userData, m.time, (process_t) sender, m.receiver, m.group, m.tag, m.length) == OTF_RETURN_OK;
+    });
+    return ok ? OTF2_CALLBACK_SUCCESS : OTF2_CALLBACK_ERROR;
+}
+
+static OTF2_CallbackCode releaseOtf2Receives(void* userData, OTF2_LocationRef receiver) {
+    auto& u = *((EventUserData*) userData);
+    bool ok = u.receiveRequests[receiver].release([userData, receiver](const ReceivedMessage& m) {
+        return handleReceiveMessage(userData, m.time, (process_t) receiver, m.sender, m.group, m.tag, m.length) == OTF_RETURN_OK;
+    });
+    return ok ? OTF2_CALLBACK_SUCCESS : OTF2_CALLBACK_ERROR;
+}
+
 static OTF2_CallbackCode handleOtf2MpiSend(OTF2_LocationRef sender, OTF2_TimeStamp time, void* userData, OTF2_AttributeList* a, uint32_t localReceiverRank, OTF2_CommRef com, uint32_t tag, uint64_t length) {
     (void) a;
     auto& u = *((EventUserData*) userData);
 
-    assert(u.localRankToLocation.contains(QPair<OTF2_CommRef, uint32_t>(com, localReceiverRank)));
-    auto receiver = u.localRankToLocation[QPair<OTF2_CommRef, uint32_t>(com, localReceiverRank)];
+    u.statistics.sends += 1;
 
-    if (u.isends[sender].isEmpty()) {
+    auto receiver = u.location(com, localReceiverRank);
+    assert(receiver != OTF2_UNDEFINED_LOCATION);
+
+    auto& requests = u.sendRequests[sender];
+    if (requests.isEmpty()) {
         if (handleSendMessage(userData, (timestamp_t) time, (process_t) sender, (process_t) receiver, (processgroup_t) com, (messagetag_t) tag, (messagelength_t) length) == OTF_RETURN_OK) {
             return OTF2_CALLBACK_SUCCESS;
         } else {
             return OTF2_CALLBACK_ERROR;
         }
     } else { // for correct send/recv matching we need to withhold this send until the previously issued isends are done
-        u.isends[sender].last().blockedSends.enqueue(SentMessage{(timestamp_t) time, (process_t) receiver, (processgroup_t) com, (messagelength_t) length, (messagetag_t) tag});
+        requests.issue(SentMessage{(timestamp_t) time, (process_t) receiver, (processgroup_t) com, (messagelength_t) length, (messagetag_t) tag, 0});
         return OTF2_CALLBACK_SUCCESS;
     }
 }
@@ -648,10 +2227,12 @@ static OTF2_CallbackCode handleOtf2MpiIsend(OTF2_LocationRef sender, OTF2_TimeSt
     (void) a;
     auto& u = *((EventUserData*) userData);
 
-    assert(u.localRankToLocation.contains(QPair<OTF2_CommRef, uint32_t>(com, localReceiverRank)));
-    auto receiver = u.localRankToLocation[QPair<OTF2_CommRef, uint32_t>(com, localReceiverRank)];
+    u.statistics.isends += 1;
+
+    auto receiver = u.location(com, localReceiverRank);
+    assert(receiver != OTF2_UNDEFINED_LOCATION);
 
-    u.isends[sender].enqueue(EventUserData::Isend{time, sender, receiver, com, length, tag, requestId, QQueue<SentMessage>{}});
+    u.sendRequests[sender].issueRequest(requestId, SentMessage{(timestamp_t) time, (process_t) receiver, (processgroup_t) com, (messagelength_t) length, (messagetag_t) tag, 0});
 
     return OTF2_CALLBACK_SUCCESS;
 }
@@ -660,104 +2241,49 @@ static OTF2_CallbackCode handleOtf2MpiIsendComplete(OTF2_LocationRef sender, OTF
     (void) time; (void) a;
     auto& u = *((EventUserData*) userData);
 
-    auto& isends = u.isends[sender];
-
-    // find the matching isend
-    int index = -1;
-    for (int i = 0; i < isends.size(); i += 1) {
-        if (isends[i].requestId == requestId) {
-            index = i;
-            break;
-        }
-    }
-    assert(index != -1);
-
-    const auto& s = isends[index];
-
-    if (index == 0) {
-        if (handleSendMessage(userData, (timestamp_t) s.time, (process_t) sender, (process_t) s.receiver, (processgroup_t) s.com, (messagetag_t) s.tag, (messagelength_t) s.length) != OTF_RETURN_OK) {
-            return OTF2_CALLBACK_ERROR;
-        }
-
-        foreach (const auto& b, s.blockedSends) {
-            if (handleSendMessage(userData, b.time, (process_t) sender, b.receiver, b.group, b.tag, b.length) != OTF_RETURN_OK) {
-                return OTF2_CALLBACK_ERROR;
-            }
-        }
-    } else {
-        isends[index-1].blockedSends.enqueue(SentMessage{(timestamp_t) s.time, (process_t) s.receiver, (processgroup_t) s.com, (messagelength_t) s.length, (messagetag_t) s.tag});
-
-        isends[index-1].blockedSends.append(s.blockedSends);
-    }
-
-    isends.removeAt(index);
+    u.sendRequests[sender].complete(requestId); // the send keeps the time of the isend
 
-    return OTF2_CALLBACK_SUCCESS;
+    return releaseOtf2Sends(userData, sender);
 }
 
 static OTF2_CallbackCode handleOtf2MpiRecv(OTF2_LocationRef receiver, OTF2_TimeStamp time, void* userData, OTF2_AttributeList* a, uint32_t localSenderRank, OTF2_CommRef com, uint32_t tag, uint64_t length) {
     (void) a;
     auto& u = *((EventUserData*) userData);
 
-    assert(u.localRankToLocation.contains(QPair<OTF2_CommRef, uint32_t>(com, localSenderRank)));
-    auto sender = u.localRankToLocation[QPair<OTF2_CommRef, uint32_t>(com, localSenderRank)];
+    u.statistics.receives += 1;
+
+    auto sender = u.location(com, localSenderRank);
+    assert(sender != OTF2_UNDEFINED_LOCATION);
 
-    if (u.ireceiveRequests[receiver].isEmpty()) {
+    auto& requests = u.receiveRequests[receiver];
+    if (requests.isEmpty()) {
         if (handleReceiveMessage(userData, (timestamp_t) time, (process_t) receiver, (process_t) sender, (processgroup_t) com, (messagetag_t) tag, (messagelength_t) length) == OTF_RETURN_OK) {
             return OTF2_CALLBACK_SUCCESS;
         } else {
             return OTF2_CALLBACK_ERROR;
         }
     } else {
-        u.ireceiveRequests[receiver].last().blockedReceives.enqueue(ReceivedMessage{(timestamp_t) time, (process_t) sender, (processgroup_t) com, (messagelength_t) length, (messagetag_t) tag});
+        requests.issue(ReceivedMessage{(timestamp_t) time, (process_t) sender, (processgroup_t) com, (messagelength_t) length, (messagetag_t) tag, 0});
         return OTF2_CALLBACK_SUCCESS;
     }
 }
 
 static OTF2_CallbackCode handleOtf2MpiIrecv(OTF2_LocationRef receiver, OTF2_TimeStamp time, void *userData, OTF2_AttributeList *a, uint32_t sender, OTF2_CommRef com, uint32_t tag, uint64_t length, uint64_t requestId) {
     (void) a;
-
     auto& u = *((EventUserData*) userData);
 
-    auto& ireceiveRequests = u.ireceiveRequests[receiver];
-
-    // find the matching ireceive request
-    int index = -1;
-    for (int i = 0; i < ireceiveRequests.size(); i += 1) {
-        if (ireceiveRequests[i].requestId == requestId) {
-            index = i;
-            break;
-        }
-    }
-    assert(index != -1);
-
-    const auto& r = ireceiveRequests[index];
-
-    if (index == 0) {
-        if (handleReceiveMessage(userData, (timestamp_t) time, (process_t) receiver, (process_t) sender, (processgroup_t) com, (messagetag_t) tag, (messagelength_t) length) != OTF_RETURN_OK) {
-            return OTF2_CALLBACK_ERROR;
-        }
-
-        foreach (const auto& b, r.blockedReceives) {
-            if (handleReceiveMessage(userData, b.time, (process_t) receiver, b.sender, b.group, b.tag, b.length) != OTF_RETURN_OK) {
-                return OTF2_CALLBACK_ERROR;
-            }
-        }
-    } else {
-        ireceiveRequests[index-1].blockedReceives.enqueue(ReceivedMessage{(timestamp_t) time, (process_t) sender, (processgroup_t) com, (messagelength_t) length, (messagetag_t) tag});
-
-        ireceiveRequests[index-1].blockedReceives.append(r.blockedReceives);
-    }
+    u.statistics.irecvs += 1;
 
-    ireceiveRequests.removeAt(index);
+    auto r = ReceivedMessage{(timestamp_t) time, (process_t) sender, (processgroup_t) com, (messagelength_t) length, (messagetag_t) tag, 0};
+    u.receiveRequests[receiver].complete(requestId, &r);
 
-    return OTF2_CALLBACK_SUCCESS;
+    return releaseOtf2Receives(userData, receiver);
 }
 
 static OTF2_CallbackCode handleOtf2MpiIrecvRequest(OTF2_LocationRef receiver, OTF2_TimeStamp time, void *userData, OTF2_AttributeList *a, uint64_t requestId) {
     (void) time; (void) a;
     auto& u = *((EventUserData*) userData);
-    u.ireceiveRequests[receiver].enqueue(EventUserData::IreceiveRequest{requestId, QQueue<ReceivedMessage>{}});
+    u.receiveRequests[receiver].issueRequest(requestId);
     return OTF2_CALLBACK_SUCCESS;
 }
 
@@ -766,72 +2292,81 @@ static OTF2_CallbackCode handleOtf2MpiRequestCancelled(OTF2_LocationRef location
 
     auto& u = *((EventUserData*) userData);
 
-    auto& ireceiveRequests = u.ireceiveRequests[locationId];
-    auto& isends           = u.isends[locationId];
+    auto& receiveRequests = u.receiveRequests[locationId];
+    auto& sendRequests    = u.sendRequests   [locationId];
 
-    // find the matching ireceive request
-    int ireceiveRequestIndex = -1;
-    for (int i = 0; i < ireceiveRequests.size(); i += 1) {
-        if (ireceiveRequests[i].requestId == requestId) {
-            ireceiveRequestIndex = i;
-            break;
-        }
-    }
+    assert((receiveRequests.hasRequest(requestId) && sendRequests.hasRequest(requestId)) == false);
 
-    // find the matching isend
-    int isendIndex = -1;
-    for (int i = 0; i < isends.size(); i += 1) {
-        if (isends[i].requestId == requestId) {
-            isendIndex = i;
-            break;
-        }
+    if (receiveRequests.hasRequest(requestId)) { // like handleOtf2MpiIrecv without recording a new ireceive
+        receiveRequests.cancel(requestId);
+        return releaseOtf2Receives(userData, locationId);
+    } else if (sendRequests.hasRequest(requestId)) { // like handleOtf2MpiIsendComplete without recording a new isend
+        sendRequests.cancel(requestId);
+        return releaseOtf2Sends(userData, locationId);
+    } else { //neither ireceive request nor isend got cancelled
+        return OTF2_CALLBACK_SUCCESS;
     }
+}
 
-    assert((ireceiveRequestIndex != -1 && isendIndex != -1) == false);
+static OTF2_CallbackCode handleOtf2Enter(OTF2_LocationRef location, OTF2_TimeStamp time, void* userData, OTF2_AttributeList* a, OTF2_RegionRef region) {
+    (void) location; (void) a; (void) region;
+    if (cancelled(userData)) { return OTF2_CALLBACK_INTERRUPT; }
+    ((EventUserData*) userData)->statistics.enters += 1;
+    handleEnterOrLeave(userData, time);
+    return OTF2_CALLBACK_SUCCESS;
+}
 
-    if (ireceiveRequestIndex != -1) { // like handleOtf2MpiIrecv without recording a new ireceive
+static OTF2_CallbackCode handleOtf2Leave(OTF2_LocationRef location, OTF2_TimeStamp time, void* userData, OTF2_AttributeList* a, OTF2_RegionRef region) {
+    (void) location; (void) a; (void) region;
+    if (cancelled(userData)) { return OTF2_CALLBACK_INTERRUPT; }
+    ((EventUserData*) userData)->statistics.leaves += 1;
+    handleEnterOrLeave(userData, time);
+    return OTF2_CALLBACK_SUCCESS;
+}
 
-        if (ireceiveRequestIndex == 0) {
-            foreach (const auto& b, ireceiveRequests[ireceiveRequestIndex].blockedReceives) {
-                if (handleReceiveMessage(userData, b.time, (process_t) locationId, b.sender, b.group, b.tag, b.length) != OTF_RETURN_OK) {
-                    return OTF2_CALLBACK_ERROR;
-                }
-            }
-        } else {
-            ireceiveRequests[ireceiveRequestIndex-1].blockedReceives.append(ireceiveRequests[ireceiveRequestIndex].blockedReceives);
-        }
+// otf 2 local event reader handlers ////////////////////////////////////////
 
-        ireceiveRequests.removeAt(ireceiveRequestIndex);
+static OTF2_CallbackCode handleOtf2LocalMpiSend(OTF2_LocationRef sender, OTF2_TimeStamp time, uint64_t position, void* userData, OTF2_AttributeList* a, uint32_t receiver, OTF2_CommRef com, uint32_t tag, uint64_t length) {
+    (void) position;
+    return handleOtf2MpiSend(sender, time, userData, a, receiver, com, tag, length);
+}
 
-    } else if (isendIndex != -1) { // like handleOtf2MpiIsendComplete without record a new isend
+static OTF2_CallbackCode handleOtf2LocalMpiIsend(OTF2_LocationRef sender, OTF2_TimeStamp time, uint64_t position, void *userData, OTF2_AttributeList *a, uint32_t receiver, OTF2_CommRef com, uint32_t tag, uint64_t length, uint64_t requestId) {
+    (void) position;
+    return handleOtf2MpiIsend(sender, time, userData, a, receiver, com, tag, length, requestId);
+}
 
-        if (isendIndex == 0) {
-            foreach (const auto& b, isends[isendIndex].blockedSends) {
-                if (handleSendMessage(userData, b.time, (process_t) locationId, b.receiver, b.group, b.tag, b.length) != OTF_RETURN_OK) {
-                    return OTF2_CALLBACK_ERROR;
-                }
-            }
+static OTF2_CallbackCode handleOtf2LocalMpiIsendComplete(OTF2_LocationRef sender, OTF2_TimeStamp time, uint64_t position, void *userData, OTF2_AttributeList *a, uint64_t requestId) {
+    (void) position;
+    return handleOtf2MpiIsendComplete(sender, time, userData, a, requestId);
+}
 
-        } else {
-            isends[isendIndex-1].blockedSends.append(isends[isendIndex].blockedSends);
-        }
+static OTF2_CallbackCode handleOtf2LocalMpiRecv(OTF2_LocationRef receiver, OTF2_TimeStamp time, uint64_t position, void* userData, OTF2_AttributeList* a, uint32_t sender, OTF2_CommRef com, uint32_t tag, uint64_t length) {
+    (void) position;
+    return handleOtf2MpiRecv(receiver, time, userData, a, sender, com, tag, length);
+}
 
-        isends.removeAt(isendIndex);
+static OTF2_CallbackCode handleOtf2LocalMpiIrecv(OTF2_LocationRef receiver, OTF2_TimeStamp time, uint64_t position, void *userData, OTF2_AttributeList *a, uint32_t sender, OTF2_CommRef com, uint32_t tag, uint64_t length, uint64_t requestId) {
+    (void) position;
+    return handleOtf2MpiIrecv(receiver, time, userData, a, sender, com, tag, length, requestId);
+}
 
-    } else { //neither ireceive request nor isend got cancelled
-    }
+static OTF2_CallbackCode handleOtf2LocalMpiIrecvRequest(OTF2_LocationRef locationId, OTF2_TimeStamp time, uint64_t position, void *userData, OTF2_AttributeList *a, uint64_t requestId) {
+    (void) position;
+    return handleOtf2MpiIrecvRequest(locationId, time, userData, a, requestId);
+}
 
-    return OTF2_CALLBACK_SUCCESS;
+static OTF2_CallbackCode handleOtf2LocalMpiRequestCancelled(OTF2_LocationRef locationId, OTF2_TimeStamp time, uint64_t position, void *userData, OTF2_AttributeList *a, uint64_t requestId) {
+    (void) position;
+    return handleOtf2MpiRequestCancelled(locationId, time, userData, a, requestId);
 }
 
-static OTF2_CallbackCode handleOtf2Enter(OTF2_LocationRef location, OTF2_TimeStamp time, void* userData, OTF2_AttributeList* a, OTF2_RegionRef region) {
-    (void) location; (void) a; (void) region;
-    handleEnterOrLeave(userData, time);
-    return OTF2_CALLBACK_SUCCESS;
+static OTF2_CallbackCode handleOtf2LocalEnter(OTF2_LocationRef location, OTF2_TimeStamp time, uint64_t position, void* userData, OTF2_AttributeList* a, OTF2_RegionRef region) {
+    (void) position;
+    return handleOtf2Enter(location, time, userData, a, region);
 }
 
-static OTF2_CallbackCode handleOtf2Leave(OTF2_LocationRef location, OTF2_TimeStamp time, void* userData, OTF2_AttributeList* a, OTF2_RegionRef region) {
-    (void) location; (void) a; (void) region;
-    handleEnterOrLeave(userData, time);
-    return OTF2_CALLBACK_SUCCESS;
+static OTF2_CallbackCode handleOtf2LocalLeave(OTF2_LocationRef location, OTF2_TimeStamp time, uint64_t position, void* userData, OTF2_AttributeList* a, OTF2_RegionRef region) {
+    (void) position;
+    return handleOtf2Leave(location, time, userData, a, region);
 }
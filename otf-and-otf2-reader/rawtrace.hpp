@@ -5,6 +5,8 @@
 
 #include <otf2/otf2.h>
 
+class Diagnostics;
+class StreamingMatcher;
 class Trace;
 
 using process_t       = s64;
@@ -12,6 +14,7 @@ using processgroup_t  = s64;
 using timestamp_t     = s64;
 using messagetag_t    = s32;
 using messagelength_t = s64;
+using processindex_t  = s32; // dense 0..P-1, see RawTrace::processIndex()
 
 class RawTrace {
 public:
@@ -21,6 +24,7 @@ public:
         processgroup_t  group;
         messagelength_t length;
         messagetag_t    tag;
+        s64             ordinal; // see Filter
     };
 
     struct ReceivedMessage {
@@ -29,10 +33,113 @@ public:
         processgroup_t  group;
         messagelength_t length;
         messagetag_t    tag;
+        s64             ordinal; // see Filter
+    };
+
+    // applied while reading, so that rejected messages are never stored or matched. empty sets accept everything.
+    // a message is kept if sender and receiver are in processes, and group and tag are accepted. groups are communicators for otf2.
+    // the time range and minLength are checked per side: sends in [beginTime, endTime), receives at or after beginTime.
+    // to still pair the right messages, both sides count their position per sender/receiver/group/tag before these
+    // checks (ordinal) and are matched by it. a send whose receive was dropped is reported as missing receive.
+    // beginTime() and endTime() only cover the read events.
+    struct Filter {
+        QSet<process_t>      processes;
+        timestamp_t          beginTime = std::numeric_limits<timestamp_t>::min();
+        timestamp_t          endTime   = std::numeric_limits<timestamp_t>::max();
+        QSet<processgroup_t> groups;
+        QSet<messagetag_t>   tags;
+        messagelength_t      minLength = 0;
+
+        bool acceptsProcess(process_t p) const { return processes.isEmpty() || processes.contains(p); }
+        bool acceptsKey(process_t sender, process_t receiver, processgroup_t group, messagetag_t tag) const {
+            return acceptsProcess(sender) && acceptsProcess(receiver)
+                && (groups.isEmpty() || groups.contains(group)) && (tags.isEmpty() || tags.contains(tag));
+        }
+        bool needsOrdinals() const {
+            return beginTime != std::numeric_limits<timestamp_t>::min() || endTime != std::numeric_limits<timestamp_t>::max() || minLength > 0;
+        }
+    };
+
+    using SentMessageList     = ChunkedList<SentMessage>;
+    using ReceivedMessageList = ChunkedList<ReceivedMessage>;
+
+    // messages with the same key are received in the order they were sent, see toTrace()
+    struct MessageKey {
+        process_t      sender;
+        process_t      receiver;
+        processgroup_t group;
+        messagetag_t   tag;
+        bool operator==(const MessageKey& o) const {
+            return sender == o.sender && receiver == o.receiver && group == o.group && tag == o.tag;
+        }
+        bool operator<(const MessageKey& o) const {
+            if      (sender   < o.sender  ) { return true ; }
+            else if (sender   > o.sender  ) { return false; }
+            if      (receiver < o.receiver) { return true ; }
+            else if (receiver > o.receiver) { return false; }
+            if      (group    < o.group   ) { return true;  }
+            else if (group    > o.group   ) { return false; }
+            return tag < o.tag;
+        }
+        QString toString() const {
+            QString ret;
+            QTextStream s(&ret);
+            s << "sender " << sender << ", receiver " << receiver << ", group " << group << ", tag " << tag;
+            return ret;
+        }
+    };
+
+    // matched messages of one sender in send order, columns as in Trace
+    struct SenderMatches {
+        QVector<timestamp_t>     time;
+        QVector<timestamp_t>     duration;
+        QVector<processindex_t>  receiver;
+        QVector<messagelength_t> length;
+        QMap<MessageKey, int /*count*/> missingReceives;
+    };
+
+    // where loading time goes. always collected: the overhead is an increment per record and a few clock reads per
+    // process and phase. times add up over repeated calls.
+    struct Statistics {
+        struct Time {
+            f64 wallSeconds = 0;
+            f64 cpuSeconds  = 0;
+        };
+
+        Time                  definitions; // cpu time of all threads of the program
+        Time                  events;
+        Time                  matching;    // toTrace() and toPartialTrace()
+        QMap<process_t, Time> processes;   // reading one process, cpu time of the reading thread. only where processes are read
+                                           // one by one: LoadStrategy::PerProcess, and otf2 with LoadStrategy::Bulk
+
+        // records read, before filtering. isends and irecvs are otf2 only
+        s64 sends    = 0;
+        s64 receives = 0;
+        s64 isends   = 0;
+        s64 irecvs   = 0;
+        s64 enters   = 0; // 0 with setSkipEnterLeave(true)
+        s64 leaves   = 0;
+
+        s64 bytesRead   = 0; // otf: bytes of the event streams as read, i.e. compressed. otf2: size of the location event files
+        s64 allocations = 0; // chunks allocated for sentMessages() and receivedMessages(), see ChunkedList
+
+        // set by toTrace()
+        s64 matchedMessages   = 0;
+        s64 missingReceives   = 0; // sends without receive
+        s64 unmatchedReceives = 0; // receives without send. expected with a Filter that needs ordinals
+
+        QByteArray toJson() const;
+    };
+
+    enum class LoadStrategy {
+        PerProcess, // opens the trace once per process
+        Bulk,       // otf: opens the trace once per loader thread and reads all of its processes in one pass
+                    // otf2: opens the trace once and reads every location with its own local event reader
     };
 
 public:
-    RawTrace() {}
+    RawTrace();
+    ~RawTrace();
     RawTrace(const RawTrace&) = delete;
     RawTrace(RawTrace&&)      = delete;
 
@@ -40,28 +147,93 @@ public:
     RawTrace& operator=(RawTrace&&)      = delete;
 
     void setTraceFileName(const QString& f);
+    void setLoadThreadCount(int n); // used by loadEvents(). 1 (default) is serial, 0 uses one thread per core
+    void setLoadStrategy(LoadStrategy s); // used by loadEvents(). default is PerProcess
+    void setMatchThreadCount(int n);      // used by toTrace(). 1 (default) is serial, 0 uses one thread per core
+    void setStreamingMatching(bool b);    // match while reading, see below. call before loadEvents(). default is false
+    void setFilter(const Filter& f);      // call before loadEvents(). default accepts everything
+    void setSkipEnterLeave(bool b);       // see below. call before loadEvents(). default is false
+    void setNativeOtfParsing(bool b);     // see below. call before loadEvents(). default is false
+    void setPrintDiagnostics(bool b);     // toTrace() prints a summary of diagnostics() and the missing receives. default is true
+
+    // called from the loader threads after the events of a process have been read
+    void setProgressCallback(const std::function<void(process_t)>& f);
+    // once *cancel is true, loadEvents() stops reading as soon as possible and loads nothing. as the streaming matcher
+    // may have seen some of the messages then, a RawTrace whose loading was cancelled should be discarded.
+    void setCancelFlag(const std::atomic<bool>* cancel);
 
     void loadDefinitions();
     void loadEvents();
     void loadEvents(process_t p);
+    void loadEvents(const QSet<process_t>& ps);
+    void unloadEvents(process_t p); // frees the events of p, e.g. for LazyTrace. not with streaming matching
 
+    // earliest/latest enter or leave. with setSkipEnterLeave(true) no enter/leave records are decoded, which are most of
+    // the records. the range then comes from the otf2 clock properties or the first/last record of the otf streams,
+    // widened by the messages. it may differ slightly from the enter/leave range.
     timestamp_t beginTime() const; // needs loadEvents()
     timestamp_t endTime()   const; // needs loadEvents()
 
+    // with setNativeOtfParsing(true) loadEvents() parses otf event streams itself instead of with the otf library. it
+    // decodes only sends, receives, enters and leaves and hands them on without the library's callbacks. the result is
+    // the same, which the benchmark checks with --verify. streams that are not in the otf short format are still read
+    // by the library. no effect on otf2.
+    // if a stream can not be read after some of its records were handed on, loadEvents() prints an error and does not
+    // mark its processes as loaded, so toTrace() can not be used. what the streaming matcher has seen of them stays.
+    // with LoadStrategy::Bulk reading the files, inflating and parsing run in separate threads that are connected by
+    // bounded queues, so that they overlap. this needs up to 3 * threads threads and about 32 MiB per thread.
+
     const QSet<process_t>&            processes()      const; // needs loadDefinitions()
     const QMap<process_t, QString>&   processNames()   const; // needs loadDefinitions()
     const QMap<process_t, process_t>& processParents() const; // needs loadDefinitions()
 
-    const QList<SentMessage>&     sentMessages(process_t p)     const; // needs loadEvents(p)
-    const QList<ReceivedMessage>& receivedMessages(process_t p) const; // needs loadEvents(p)
+    // process ids are sparse (otf2 thread locations are > 0xffffffff, otf thread ids look like 100001).
+    // loadDefinitions() numbers the processes densely in Vampir Master Timeline order. Trace uses the same index.
+    const QList<process_t>& orderedProcesses()        const; // needs loadDefinitions(). index -> process
+    processindex_t          processIndex(process_t p) const; // needs loadDefinitions(). -1 if p is unknown
+
+    // streaming matching pairs sends and receives as they are read and stores only the matched messages and the ones
+    // still in flight. sentMessages() and receivedMessages() are empty then.
+    // in flight state stays small if events arrive in time order, i.e. for otf with LoadStrategy::Bulk and one loader thread.
+    const SentMessageList&     sentMessages(process_t p)     const; // needs loadEvents(p)
+    const ReceivedMessageList& receivedMessages(process_t p) const; // needs loadEvents(p)
 
-    void toTrace(Trace* t); // needs loadDefinitions and loadEvents()
+    // warnings found by toTrace(), e.g. sends that start after their receive because of clock skew
+    const Diagnostics& diagnostics() const;
+    const Statistics&  statistics()  const;
+
+    void toTrace(Trace* t);        // needs loadDefinitions and loadEvents()
+    void toPartialTrace(Trace* t); // needs loadDefinitions(). messages between processes loaded so far. prints no warnings
+
+    // matches the sends of p the same way as toTrace(), against the receives of the processes loaded so far. sends to
+    // processes that are not loaded count as missing receives, so load the receivers first. warnings go to *d, nothing
+    // is printed. for matching one sender at a time, e.g. LazyTrace. needs loadEvents(p), no streaming matching
+    void matchSends(process_t p, SenderMatches* m, Diagnostics* d) const;
 
 private:
     QString _traceFileName;
 
+    int          _loadThreadCount   = 1;
+    LoadStrategy _loadStrategy      = LoadStrategy::PerProcess;
+    int          _matchThreadCount  = 1;
+    bool         _streamingMatching = false;
+    Filter       _filter;
+    bool         _skipEnterLeave    = false;
+    bool         _nativeOtfParsing  = false;
+    bool         _printDiagnostics  = true;
+
+    std::function<void(process_t)> _progress;
+    const std::atomic<bool>*        _cancel = nullptr;
+
+    std::unique_ptr<StreamingMatcher> _matcher;
+    std::unique_ptr<Diagnostics>      _diagnostics;
+    Statistics                        _statistics;
+
+    bool        _otf2           = false; // set by loadDefinitions()
+    timestamp_t _clockBeginTime = std::numeric_limits<timestamp_t>::max(); // otf2 clock properties, set by loadDefinitions()
+    timestamp_t _clockEndTime   = std::numeric_limits<timestamp_t>::min();
+
     bool _loadedDefinitions = false;
-    QSet<process_t> _loadedEvents;
 
     timestamp_t _beginTime = std::numeric_limits<timestamp_t>::max();
     timestamp_t _endTime   = std::numeric_limits<timestamp_t>::min();
@@ -69,18 +241,32 @@ private:
     QSet<process_t>                         _processes;
     QMap<process_t, QString>                _processNames;
     QMap<process_t, process_t>              _processParents;
-    QMap<process_t, QList<SentMessage>>     _sentMessages;
-    QMap<process_t, QList<ReceivedMessage>> _receivedMessages;
+    QList<process_t>                        _orderedProcesses; // index -> process
+    QHash<process_t, processindex_t>        _processIndex;     // process -> index
 
-private:
-    // used for otf2 local to global id mapping
-    QMap<QPair<OTF2_CommRef, uint32_t /*local rank*/>, OTF2_LocationRef> _localRankToLocation;
+    // by process index
+    QVector<SentMessageList>                _sentMessages;
+    QVector<ReceivedMessageList>            _receivedMessages;
+    QVector<bool>                           _loadedEvents;
+    int                                     _loadedEventCount = 0;
 
-    const QList<SentMessage>     _emptySentMessageList;
-    const QList<ReceivedMessage> _emptyReceivedMessageList;
+private:
+    // used for otf2 local to global id mapping: [communicator][local rank] -> location, OTF2_UNDEFINED_LOCATION if unmapped.
+    // communicators with huge refs are left out, see loadDefinitions()
+    QVector<QVector<OTF2_LocationRef>> _localRankToLocation;
 
 private:
     bool loadedAllEvents() const;
+    bool loadedEvents(process_t p) const;
+    bool isCancelled()     const;
+
+    void buildTrace(Trace* t, bool partial);
+
+    void mergeEvents(QMap<process_t, SentMessageList>* sentMessages, QMap<process_t, ReceivedMessageList>* receivedMessages, timestamp_t beginTime, timestamp_t endTime);
 };
 
+inline uint qHash(const RawTrace::MessageKey& k, uint seed = 0) {
+    return qHash(qMakePair(qMakePair((qint64) k.sender, (qint64) k.receiver), qMakePair((qint64) k.group, k.tag)), seed);
+}
+
 #endif // EDGE_BUNDLING_PROTOTYPE_RAWTRACE_HPP
@@ -21,10 +21,182 @@ const QMap<process_t, QString>& Trace::processNames() const {
     return _processNames;
 }
 
-const QList<Trace::Message>& Trace::messages(process_t p) const {
-    if (_messages.contains(p)) {
-        return _messages.constFind(p).value();
+processindex_t Trace::processIndex(process_t p) const {
+    return _processIndex.value(p, -1);
+}
+
+const QMap<process_t, process_t>& Trace::processParents() const {
+    return _processParents;
+}
+
+int Trace::hierarchyLevelCount() const {
+    std::call_once(_rollupsBuilt, [this]() { buildRollups(); });
+    return _rollups.size();
+}
+
+const CommunicationMatrix& Trace::communication(int level) const {
+    std::call_once(_rollupsBuilt, [this]() { buildRollups(); });
+    assert(level >= 0 && level < _rollups.size());
+    return _rollups[level];
+}
+
+Trace::MessageList Trace::messages(process_t p) const {
+    auto it = _processIndex.constFind(p);
+    if (it != _processIndex.constEnd()) {
+        return messagesAt(it.value());
     } else {
-        return _emptyMessageList;
+        return MessageList();
+    }
+}
+
+Trace::MessageList Trace::messagesAt(processindex_t i) const {
+    assert(i >= 0 && i < _orderedProcesses.size());
+    s64 first = _messageOffsets[i];
+    s64 end   = _messageOffsets[i+1];
+    return MessageList(_time + first, _duration + first, _receiver + first, _length + first, end - first);
+}
+
+Trace::MessageList Trace::allMessages() const {
+    return MessageList(_time, _duration, _receiver, _length, _messageOffsets.isEmpty() ? 0 : _messageOffsets.last());
+}
+
+Trace::Span<s64> Trace::messageOffsets() const {
+    return Span<s64>(_messageOffsets.constData(), _messageOffsets.size());
+}
+
+static timestamp_t endTime(timestamp_t time, timestamp_t duration) {
+    return time + std::max(duration, (timestamp_t) 0);
+}
+
+// fills the nodes of the time index of the messages [l, r), see Trace::_maxEnd. returns the latest end time
+static timestamp_t buildMaxEnd(const timestamp_t* time, const timestamp_t* duration, timestamp_t* maxEnd, s64 l, s64 r) {
+    if (l >= r) { return std::numeric_limits<timestamp_t>::min(); }
+    s64 mid = l + (r - l) / 2;
+    maxEnd[mid] = std::max(endTime(time[mid], duration[mid]), std::max(buildMaxEnd(time, duration, maxEnd, l, mid), buildMaxEnd(time, duration, maxEnd, mid + 1, r)));
+    return maxEnd[mid];
+}
+
+void Trace::buildTimeIndex(int threadCount) {
+    assert(_timeStorage.size() == _messageOffsets.last()); // needs owned columns
+
+    _maxEndStorage.resize(_timeStorage.size());
+
+    timestamp_t*     time     = _timeStorage    .data();
+    timestamp_t*     duration = _durationStorage.data();
+    processindex_t*  receiver = _receiverStorage.data();
+    messagelength_t* length   = _lengthStorage  .data();
+    timestamp_t*     maxEnd   = _maxEndStorage  .data();
+
+    parallelFor(_orderedProcesses.size(), threadCount, [this, time, duration, receiver, length, maxEnd](int p, int thread) {
+        (void) thread;
+        s64 first = _messageOffsets[p];
+        s64 end   = _messageOffsets[p+1];
+
+        // sends of one process are recorded in time order, so this is usually a no-op
+        if (std::is_sorted(time + first, time + end) == false) {
+            QVector<s64> order(end - first);
+            std::iota(order.begin(), order.end(), first);
+            std::stable_sort(order.begin(), order.end(), [time](s64 a, s64 b) { return time[a] < time[b]; });
+
+            permute(time    , order, first);
+            permute(duration, order, first);
+            permute(receiver, order, first);
+            permute(length  , order, first);
+        }
+
+        buildMaxEnd(time, duration, maxEnd, first, end);
+    });
+
+    _maxEnd = maxEnd;
+}
+
+// calls f(i) in time order for every message i in [l, r) that is in flight during [t0, t1]. subtrees are skipped if
+// they end before t0 or start after t1, so every visited node is on the path to a result or next to one.
+template<typename F>
+static void forEachInWindow(const timestamp_t* time, const timestamp_t* duration, const timestamp_t* maxEnd, s64 l, s64 r, timestamp_t t0, timestamp_t t1, F& f) {
+    if (l >= r || time[l] > t1) { return; }
+    s64 mid = l + (r - l) / 2;
+    if (maxEnd[mid] < t0) { return; }
+
+    forEachInWindow(time, duration, maxEnd, l, mid, t0, t1, f);
+    if (time[mid] > t1) { return; }
+    if (endTime(time[mid], duration[mid]) >= t0) { f(mid); }
+    forEachInWindow(time, duration, maxEnd, mid + 1, r, t0, t1, f);
+}
+
+template<typename F>
+void Trace::forEachMessageInWindow(int processIndex, timestamp_t t0, timestamp_t t1, F&& f) const {
+    auto g = [this, &f](s64 i) { f(Message{_time[i], _duration[i], _receiver[i], _length[i]}); };
+    forEachInWindow(_time, _duration, _maxEnd, _messageOffsets[processIndex], _messageOffsets[processIndex+1], t0, t1, g);
+}
+
+QVector<Trace::Message> Trace::messages(process_t p, timestamp_t t0, timestamp_t t1) const {
+    QVector<Message> ret;
+
+    auto it = _processIndex.constFind(p);
+    if (it != _processIndex.constEnd()) {
+        forEachMessageInWindow(it.value(), t0, t1, [&ret](const Message& m) { ret.append(m); });
+    }
+
+    return ret;
+}
+
+QVector<QPair<process_t, Trace::Message>> Trace::messagesInWindow(timestamp_t t0, timestamp_t t1) const {
+    QVector<QPair<process_t, Message>> ret;
+
+    for (int p = 0; p < _orderedProcesses.size(); p += 1) {
+        process_t sender = _orderedProcesses[p];
+        forEachMessageInWindow(p, t0, t1, [&ret, sender](const Message& m) { ret.append(qMakePair(sender, m)); });
+    }
+
+    return ret;
+}
+
+void Trace::buildRollups() const {
+    QHash<process_t, int> depth;
+    int maxDepth = 0;
+
+    foreach (auto p, _orderedProcesses) {
+        int d = 0;
+        for (process_t q = p; _processParents.contains(q) && d <= _orderedProcesses.size(); q = _processParents[q]) { d += 1; } // bounded in case of cycles
+        depth[p] = d;
+        maxDepth = std::max(maxDepth, d);
+    }
+
+    _rollups.resize(maxDepth + 1);
+
+    // deepest level straight from the messages. every thread sums up its senders, then the results are merged.
+    const int threadCount = std::max(1, std::min(resolveThreadCount(0), _orderedProcesses.size()));
+    std::vector<CommunicationMatrix> perThread(threadCount);
+
+    parallelFor(_orderedProcesses.size(), threadCount, [this, &perThread](int p, int thread) {
+        process_t sender = _orderedProcesses[p];
+        auto& m = perThread[thread];
+        for (s64 i = _messageOffsets[p]; i < _messageOffsets[p+1]; i += 1) {
+            if (_receiver[i] < 0 || _receiver[i] >= _orderedProcesses.size()) { continue; } // only in a corrupt cache, see tracecache.hpp
+            auto& c = m[qMakePair(sender, _orderedProcesses[_receiver[i]])];
+            c.bytes += _length[i];
+            c.count += 1;
+        }
+    });
+
+    for (const auto& m : perThread) {
+        addCommunication(&_rollups[maxDepth], m);
+    }
+
+    // every level above replaces the endpoints that are too deep by their parents
+    for (int level = maxDepth - 1; level >= 0; level -= 1) {
+        auto up = [&depth, level, this](process_t p) {
+            return depth.value(p, 0) > level ? _processParents.value(p, p) : p;
+        };
+
+        const auto& below = _rollups[level + 1];
+        auto& m = _rollups[level];
+
+        for (auto it = below.constBegin(); it != below.constEnd(); ++it) {
+            auto& c = m[qMakePair(up(it.key().first), up(it.key().second))];
+            c.bytes += it.value().bytes;
+            c.count += it.value().count;
+        }
     }
 }
@@ -3,6 +3,7 @@
 
 #include "prereqs.hpp"
 
+#include "communicationmatrix.hpp"
 #include "rawtrace.hpp"
 
 class Trace {
@@ -10,8 +11,103 @@ public:
     struct Message {
         timestamp_t     time;
         timestamp_t     duration;
-        process_t       receiver;
-        messagelength_t length; // only sender size counts
+        processindex_t  receiver; // orderedProcesses()[receiver]
+        messagelength_t length;   // only sender size counts
+    };
+
+    template<typename T>
+    class Span {
+    public:
+        using value_type     = T;
+        using const_iterator = const T*;
+
+        Span() {}
+        Span(const T* begin, s64 size) : _begin(begin), _end(begin + size) {}
+
+        const_iterator begin() const { return _begin; }
+        const_iterator end()   const { return _end;   }
+
+        s64  size()    const { return _end - _begin; }
+        bool isEmpty() const { return _begin == _end; }
+
+        const T& operator[](s64 i) const { assert(i >= 0 && i < size()); return _begin[i]; }
+
+    private:
+        const T* _begin = nullptr;
+        const T* _end   = nullptr;
+    };
+
+    // view of the messages of one sender (or of all senders, see allMessages()). valid as long as the Trace lives.
+    // the messages are stored column-wise. iterating yields assembled Messages, the columns are accessible as spans.
+    class MessageList {
+    public:
+        // random access, but dereferencing assembles a Message from the columns, so reference is not a real reference
+        class const_iterator {
+        public:
+            using iterator_category = std::random_access_iterator_tag;
+            using value_type        = Message;
+            using difference_type   = s64;
+            using pointer           = void;
+            using reference         = Message;
+
+            const_iterator() {}
+            const_iterator(const MessageList& l, s64 i) : _time(l._time), _duration(l._duration), _receiver(l._receiver), _length(l._length), _i(i) {}
+
+            Message          operator* ()                          const { return Message{_time[_i], _duration[_i], _receiver[_i], _length[_i]}; }
+            Message          operator[](s64 n)                     const { return *(*this + n); }
+            const_iterator&  operator++()                                { _i += 1; return *this; }
+            const_iterator&  operator--()                                { _i -= 1; return *this; }
+            const_iterator   operator++(int)                             { auto r = *this; _i += 1; return r; }
+            const_iterator   operator--(int)                             { auto r = *this; _i -= 1; return r; }
+            const_iterator&  operator+=(s64 n)                           { _i += n; return *this; }
+            const_iterator&  operator-=(s64 n)                           { _i -= n; return *this; }
+            const_iterator   operator+ (s64 n)                     const { auto r = *this; r._i += n; return r; }
+            const_iterator   operator- (s64 n)                     const { auto r = *this; r._i -= n; return r; }
+            s64              operator- (const const_iterator& o)   const { return _i - o._i; }
+            bool             operator==(const const_iterator& o)   const { return _i == o._i; }
+            bool             operator!=(const const_iterator& o)   const { return _i != o._i; }
+            bool             operator< (const const_iterator& o)   const { return _i <  o._i; }
+            bool             operator> (const const_iterator& o)   const { return _i >  o._i; }
+            bool             operator<=(const const_iterator& o)   const { return _i <= o._i; }
+            bool             operator>=(const const_iterator& o)   const { return _i >= o._i; }
+            friend const_iterator operator+(s64 n, const const_iterator& i) { return i + n; }
+
+        private:
+            // the columns, not the list, so that iterators outlive a temporary MessageList, e.g. t.messages(p).begin()
+            const timestamp_t*     _time     = nullptr;
+            const timestamp_t*     _duration = nullptr;
+            const processindex_t*  _receiver = nullptr;
+            const messagelength_t* _length   = nullptr;
+            s64                    _i        = 0;
+        };
+
+        using value_type = Message;
+
+        MessageList() {}
+        MessageList(const timestamp_t* time, const timestamp_t* duration, const processindex_t* receiver, const messagelength_t* length, s64 size)
+            : _time(time), _duration(duration), _receiver(receiver), _length(length), _size(size) {}
+
+        const_iterator begin() const { return const_iterator(*this, 0);     }
+        const_iterator end()   const { return const_iterator(*this, _size); }
+
+        s64  size()    const { return _size;      }
+        bool isEmpty() const { return _size == 0; }
+
+        Message operator[](s64 i) const { assert(i >= 0 && i < _size); return Message{_time[i], _duration[i], _receiver[i], _length[i]}; }
+        Message first()           const { return (*this)[0];       }
+        Message last()            const { return (*this)[_size-1]; }
+
+        Span<timestamp_t>     times()     const { return Span<timestamp_t>    (_time,     _size); }
+        Span<timestamp_t>     durations() const { return Span<timestamp_t>    (_duration, _size); }
+        Span<processindex_t>  receivers() const { return Span<processindex_t> (_receiver, _size); }
+        Span<messagelength_t> lengths()   const { return Span<messagelength_t>(_length,   _size); }
+
+    private:
+        const timestamp_t*     _time     = nullptr;
+        const timestamp_t*     _duration = nullptr;
+        const processindex_t*  _receiver = nullptr;
+        const messagelength_t* _length   = nullptr;
+        s64                    _size     = 0;
     };
 
 public:
@@ -28,8 +124,29 @@ public:
     const QSet<process_t>&          processes()        const;
     const QList<process_t>&         orderedProcesses() const; // order of the Vampir Master Timeline
     const QMap<process_t, QString>& processNames()     const;
+    processindex_t                  processIndex(process_t p) const; // index into orderedProcesses(), -1 if p is unknown. same as RawTrace::processIndex()
+
+    MessageList messages(process_t p)        const;
+    MessageList messagesAt(processindex_t i) const; // messages(orderedProcesses()[i])
+    MessageList allMessages()         const; // grouped by sender in orderedProcesses() order
+    Span<s64>   messageOffsets()      const; // messages of orderedProcesses()[i] are allMessages()[messageOffsets()[i] .. messageOffsets()[i+1]-1]
+
+    // messages in flight during [t0, t1], i.e. time <= t1 and time + duration >= t0. negative durations count as 0.
+    // sorted by time. every sender's messages form an interval tree, see buildTimeIndex(). for a sender with n
+    // messages and k results this costs O(log n + k log n) in the worst case. messagesInWindow() asks every sender,
+    // but senders whose messages all start after t1 or all end before t0 cost O(1).
+    QVector<Message>                              messages(process_t p, timestamp_t t0, timestamp_t t1) const;
+    QVector<QPair<process_t /*sender*/, Message>> messagesInWindow(timestamp_t t0, timestamp_t t1)      const;
 
-    const QList<Message>& messages(process_t p) const;
+    // process hierarchy, e.g. process -> threads (otf) or process -> locations (otf2). see RawTrace::processParents()
+    // level 0 are the processes without parent, level 1 their children, and so on.
+    const QMap<process_t, process_t>& processParents()      const;
+    int                               hierarchyLevelCount() const;
+
+    // all messages summed up with both sender and receiver replaced by their ancestor on the given level.
+    // processes above that level stay as they are. the deepest level is the plain process x process matrix.
+    // all levels are built together on first use, in one parallel pass over the messages.
+    const CommunicationMatrix& communication(int level) const;
 
 private:
     timestamp_t _beginTime = std::numeric_limits<timestamp_t>::max();
@@ -38,12 +155,43 @@ private:
     QSet<process_t>                            _processes;
     QList<process_t>                           _orderedProcesses;
     QMap<process_t, QString>                   _processNames;
-    QMap<process_t /*sender*/, QList<Message>> _messages;
+    QMap<process_t, process_t>                 _processParents;
+
+    // all messages as columns, grouped by sender in _orderedProcesses order (compressed sparse rows)
+    QVector<timestamp_t>     _timeStorage;     // the storage vectors are empty if the columns are memory-mapped from a cache
+    QVector<timestamp_t>     _durationStorage;
+    QVector<processindex_t>  _receiverStorage;
+    QVector<messagelength_t> _lengthStorage;
+    const timestamp_t*       _time     = nullptr;
+    const timestamp_t*       _duration = nullptr;
+    const processindex_t*    _receiver = nullptr;
+    const messagelength_t*   _length   = nullptr;
+    QVector<s64>             _messageOffsets; // size is _orderedProcesses.size()+1
+    QHash<process_t, processindex_t> _processIndex; // index into _orderedProcesses
+
+    // time index: per sender, messages are sorted by time and form an implicit balanced tree. the node of the messages
+    // [l, r) is their middle one, l + (r - l) / 2, and its entry is the latest end time of all of them (augmented
+    // interval tree)
+    QVector<timestamp_t>     _maxEndStorage;
+    const timestamp_t*       _maxEnd = nullptr;
+
+    std::unique_ptr<QFile> _cacheFile; // keeps the mapping alive, see tracecache.hpp
+
+    // hierarchical rollups, see communication()
+    mutable std::once_flag               _rollupsBuilt;
+    mutable QVector<CommunicationMatrix> _rollups;
 
 private:
-    const QList<Message> _emptyMessageList;
+    void buildTimeIndex(int threadCount); // sorts every sender's messages by time (stable) and builds _maxEnd
+
+    void buildRollups() const;
+
+    template<typename F>
+    void forEachMessageInWindow(int processIndex, timestamp_t t0, timestamp_t t1, F&& f) const;
 
     friend RawTrace;
+    friend bool readTraceCache(const QString& traceFileName, Trace* t);
+    friend void writeTraceCache(const QString& traceFileName, const Trace& t);
 };
 
 #endif // EDGE_BUNDLING_PROTOTYPE_TRACE_HPP
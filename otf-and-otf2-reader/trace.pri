@@ -7,10 +7,21 @@ LIBS += \
 	$$system(otfconfig --libs | sed -e 's/-lotfaux//' ) \
 	$$system(otf2-config --ldflags) \
 	$$system(otf2-config --libs) \
+	-lz
 
 HEADERS += \
+	$$PWD/asynctraceloader.hpp \
+	$$PWD/communicationmatrix.hpp \
+	$$PWD/diagnostics.hpp \
+	$$PWD/lazytrace.hpp \
 	$$PWD/rawtrace.hpp \
-	$$PWD/trace.hpp
+	$$PWD/trace.hpp \
+	$$PWD/tracecache.hpp
 SOURCES += \
+	$$PWD/asynctraceloader.cpp \
+	$$PWD/communicationmatrix.cpp \
+	$$PWD/diagnostics.cpp \
+	$$PWD/lazytrace.cpp \
 	$$PWD/rawtrace.cpp \
-	$$PWD/trace.cpp
+	$$PWD/trace.cpp \
+	$$PWD/tracecache.cpp
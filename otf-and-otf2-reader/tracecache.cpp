@@ -0,0 +1,230 @@
+#include "tracecache.hpp"
+
+#include "rawtrace.hpp"
+#include "trace.hpp"
+
+// layout:
+//   u32 magic, u32 version, u32 byte order mark, u32 column element size, u64 header size
+//   header (QDataStream), see CacheHeader
+//   padding to 8 bytes
+//   timestamp_t[message count] time, timestamp_t[message count] duration, messagelength_t[message count] length,
+//   timestamp_t[message count] latest end time per node of the time index (see Trace::buildTimeIndex()),
+//   processindex_t[message count] receiver. last, so that the 8 byte columns stay aligned
+static const u32 cacheMagic     = 0x45425443; // "EBTC"
+static const u32 cacheVersion   = 7;
+static const u32 cacheByteOrder = 0x01020304;
+
+static const int cachePreambleSize = 4*sizeof(u32) + sizeof(u64);
+
+static const u32 cacheColumnElementSize = 8;
+
+static const u32 cacheReceiverElementSize = 4;
+
+static_assert(sizeof(timestamp_t) == cacheColumnElementSize && sizeof(messagelength_t) == cacheColumnElementSize && sizeof(processindex_t) == cacheReceiverElementSize, "the columns are written and mapped as is");
+
+using CacheKey = QList<QPair<QString /*file*/, QPair<qint64 /*size*/, qint64 /*mtime*/>>>;
+
+// every file that belongs to the trace. otf: "a.otf", "a.0.def", "a.1.events.z", ... otf2: "a.otf2", "a.def", "a/*"
+static CacheKey cacheKey(const QString& traceFileName) {
+    QFileInfo traceFile(traceFileName);
+    QDir dir = traceFile.absoluteDir();
+    QString base = traceFile.completeBaseName();
+    QString cacheFile = QFileInfo(traceCacheFileName(traceFileName)).fileName();
+
+    CacheKey key;
+    key.append(qMakePair(traceFile.absoluteFilePath(), qMakePair((qint64) 0, (qint64) 0)));
+
+    foreach (const auto& f, dir.entryInfoList(QStringList{base + ".*"}, QDir::Files, QDir::Name)) {
+        if (f.fileName() == cacheFile) { continue; }
+        key.append(qMakePair(f.fileName(), qMakePair(f.size(), f.lastModified().toMSecsSinceEpoch())));
+    }
+
+    if (dir.exists(base)) {
+        QDirIterator i(dir.filePath(base), QDir::Files, QDirIterator::Subdirectories);
+        QList<QFileInfo> files;
+        while (i.hasNext()) {
+            i.next();
+            files.append(i.fileInfo());
+        }
+        std::sort(files.begin(), files.end(), [](const QFileInfo& a, const QFileInfo& b) { return a.filePath() < b.filePath(); });
+        foreach (const auto& f, files) {
+            key.append(qMakePair(dir.relativeFilePath(f.filePath()), qMakePair(f.size(), f.lastModified().toMSecsSinceEpoch())));
+        }
+    }
+
+    return key;
+}
+
+QString traceCacheFileName(const QString& traceFileName) {
+    return traceFileName + ".cache";
+}
+
+// QDataStream has no operators for long, which s64 is on some platforms. so everything is converted to qint64 first.
+struct CacheHeader {
+    CacheKey               key;
+    qint64                 beginTime;
+    qint64                 endTime;
+    QVector<qint64>        orderedProcesses; // all processes
+    QMap<qint64, QString>  processNames;
+    QMap<qint64, qint64>   processParents;
+    QVector<qint64>        messageOffsets;
+    qint64                 messageCount;
+    qint64                 maxReceiver; // -1 without messages. so that the receiver column need not be read on open
+};
+
+static QDataStream& operator<<(QDataStream& s, const CacheHeader& h) {
+    return s << h.key << h.beginTime << h.endTime << h.orderedProcesses << h.processNames << h.processParents << h.messageOffsets << h.messageCount << h.maxReceiver;
+}
+
+static QDataStream& operator>>(QDataStream& s, CacheHeader& h) {
+    return s >> h.key >> h.beginTime >> h.endTime >> h.orderedProcesses >> h.processNames >> h.processParents >> h.messageOffsets >> h.messageCount >> h.maxReceiver;
+}
+
+bool readTraceCache(const QString& traceFileName, Trace* t) {
+    assert(t->_messageOffsets.isEmpty());
+
+    auto file = std::unique_ptr<QFile>(new QFile(traceCacheFileName(traceFileName)));
+    if (file->open(QIODevice::ReadOnly) == false) { return false; }
+    if (file->size() < cachePreambleSize)          { return false; }
+
+    const uchar* data = file->map(0, file->size());
+    if (data == nullptr) { return false; }
+
+    u32 preamble[4];
+    u64 headerSize;
+    memcpy(preamble, data, sizeof(preamble));
+    memcpy(&headerSize, data + sizeof(preamble), sizeof(headerSize));
+
+    if (preamble[0] != cacheMagic || preamble[1] != cacheVersion || preamble[2] != cacheByteOrder || preamble[3] != cacheColumnElementSize) { return false; }
+    if (headerSize > (u64) file->size() - cachePreambleSize || headerSize > (u64) std::numeric_limits<int>::max()) { return false; } // not the sum, which could wrap
+
+    QByteArray headerData = QByteArray::fromRawData((const char*) data + cachePreambleSize, (int) headerSize);
+    QDataStream s(headerData);
+    s.setVersion(QDataStream::Qt_5_0);
+
+    CacheHeader h;
+    s >> h;
+    if (s.status() != QDataStream::Ok)      { return false; }
+    if (h.key != cacheKey(traceFileName))   { return false; }
+    if (h.messageOffsets.size() != h.orderedProcesses.size() + 1 || h.messageOffsets.last() != h.messageCount) { return false; }
+    if (h.messageOffsets.first() != 0)      { return false; }
+    for (int k = 1; k < h.messageOffsets.size(); k += 1) {
+        if (h.messageOffsets[k] < h.messageOffsets[k-1]) { return false; } // the columns are indexed with these
+    }
+
+    // messageCount is bounded by the file size before anything is multiplied with it, so that nothing wraps
+    u64 columnOffset = (cachePreambleSize + headerSize + 7) / 8 * 8;
+    u64 rowSize      = 4 * cacheColumnElementSize + cacheReceiverElementSize;
+    if (columnOffset > (u64) file->size()) { return false; }
+    if (h.messageCount < 0 || (u64) h.messageCount > ((u64) file->size() - columnOffset) / rowSize) { return false; }
+    u64 columnSize   = h.messageCount * cacheColumnElementSize;
+
+    if (h.maxReceiver < (h.messageCount > 0 ? 0 : -1) || h.maxReceiver >= h.orderedProcesses.size()) { return false; } // receivers index orderedProcesses()
+
+    t->_beginTime = (timestamp_t) h.beginTime;
+    t->_endTime   = (timestamp_t) h.endTime;
+
+    foreach (auto p, h.orderedProcesses) {
+        t->_processIndex[(process_t) p] = t->_orderedProcesses.size();
+        t->_processes.insert((process_t) p);
+        t->_orderedProcesses.append((process_t) p);
+    }
+
+    QMapIterator<qint64, QString> i(h.processNames);
+    while (i.hasNext()) {
+        i.next();
+        t->_processNames[(process_t) i.key()] = i.value();
+    }
+
+    QMapIterator<qint64, qint64> j(h.processParents);
+    while (j.hasNext()) {
+        j.next();
+        t->_processParents[(process_t) j.key()] = (process_t) j.value();
+    }
+
+    foreach (auto o, h.messageOffsets) {
+        t->_messageOffsets.append((s64) o);
+    }
+
+    t->_time      = (const timestamp_t*)     (data + columnOffset               );
+    t->_duration  = (const timestamp_t*)     (data + columnOffset + 1*columnSize);
+    t->_length    = (const messagelength_t*) (data + columnOffset + 2*columnSize);
+    t->_maxEnd    = (const timestamp_t*)     (data + columnOffset + 3*columnSize);
+    t->_receiver  = (const processindex_t*)  (data + columnOffset + 4*columnSize);
+    t->_cacheFile = std::move(file);
+
+    return true;
+}
+
+void writeTraceCache(const QString& traceFileName, const Trace& t) {
+    CacheHeader h;
+    h.key          = cacheKey(traceFileName);
+    h.beginTime    = t._beginTime;
+    h.endTime      = t._endTime;
+    h.messageCount = t._messageOffsets.isEmpty() ? 0 : t._messageOffsets.last();
+    h.maxReceiver  = h.messageCount > 0 ? *std::max_element(t._receiver, t._receiver + h.messageCount) : -1;
+
+    foreach (auto p, t._orderedProcesses) {
+        h.orderedProcesses.append(p);
+    }
+
+    QMapIterator<process_t, QString> i(t._processNames);
+    while (i.hasNext()) {
+        i.next();
+        h.processNames[i.key()] = i.value();
+    }
+
+    QMapIterator<process_t, process_t> j(t._processParents);
+    while (j.hasNext()) {
+        j.next();
+        h.processParents[j.key()] = j.value();
+    }
+
+    foreach (auto o, t._messageOffsets) {
+        h.messageOffsets.append(o);
+    }
+
+    QByteArray headerData;
+    QDataStream s(&headerData, QIODevice::WriteOnly);
+    s.setVersion(QDataStream::Qt_5_0);
+    s << h;
+
+    QSaveFile file(traceCacheFileName(traceFileName));
+    if (file.open(QIODevice::WriteOnly) == false) {
+        qerr << "warning: could not write trace cache \"" << file.fileName() << "\".\n";
+        return;
+    }
+
+    u32 preamble[4] = {cacheMagic, cacheVersion, cacheByteOrder, cacheColumnElementSize};
+    u64 headerSize = headerData.size();
+    file.write((const char*) preamble, sizeof(preamble));
+    file.write((const char*) &headerSize, sizeof(headerSize));
+    file.write(headerData);
+
+    u64 padding = (cachePreambleSize + headerSize + 7) / 8 * 8 - (cachePreambleSize + headerSize);
+    file.write(QByteArray((int) padding, '\0'));
+    file.write((const char*) t._time,     h.messageCount * cacheColumnElementSize);
+    file.write((const char*) t._duration, h.messageCount * cacheColumnElementSize);
+    file.write((const char*) t._length,   h.messageCount * cacheColumnElementSize);
+    file.write((const char*) t._maxEnd,   h.messageCount * cacheColumnElementSize);
+    file.write((const char*) t._receiver, h.messageCount * cacheReceiverElementSize);
+
+    if (file.commit() == false) {
+        qerr << "warning: could not write trace cache \"" << file.fileName() << "\".\n";
+    }
+}
+
+void loadTrace(const QString& traceFileName, Trace* t) {
+    if (readTraceCache(traceFileName, t)) { return; }
+
+    RawTrace r;
+    r.setTraceFileName(traceFileName);
+    r.setLoadThreadCount(0);
+    r.setLoadStrategy(RawTrace::LoadStrategy::Bulk);
+    r.setMatchThreadCount(0);
+    r.loadDefinitions();
+    r.loadEvents();
+    r.toTrace(t);
+
+    writeTraceCache(traceFileName, *t);
+}
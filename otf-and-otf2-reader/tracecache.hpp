@@ -0,0 +1,25 @@
+#ifndef EDGE_BUNDLING_PROTOTYPE_TRACECACHE_HPP
+#define EDGE_BUNDLING_PROTOTYPE_TRACECACHE_HPP
+
+#include "prereqs.hpp"
+
+class Trace;
+
+// Binary cache of a matched Trace, stored next to the trace as "<trace file name>.cache".
+//
+// The cache is keyed by the trace file name and the size and modification time of every file that belongs to the trace.
+// If any of them changes, the cache is stale.
+// The message array is memory-mapped when reading the cache, so opening an already seen trace costs almost nothing.
+// Only the header is checked on open. The largest receiver is stored there, so the receiver column is not read. Trace
+// still skips receivers that are not valid process indices, in case the columns are corrupt.
+// The cache is only valid on machines with the same byte order and type sizes. Otherwise it counts as stale, too.
+
+QString traceCacheFileName(const QString& traceFileName);
+
+bool readTraceCache(const QString& traceFileName, Trace* t); // returns false if there is no valid cache. t must be empty
+void writeTraceCache(const QString& traceFileName, const Trace& t);
+
+// reads the cache if it is valid. otherwise loads the trace via RawTrace and rewrites the cache.
+void loadTrace(const QString& traceFileName, Trace* t);
+
+#endif // EDGE_BUNDLING_PROTOTYPE_TRACECACHE_HPP